@@ -1,6 +1,8 @@
 #include <benchmark/benchmark.h>
 #include <hyperspace_navigator.hpp>
 
+#include <atomic>
+
 using namespace hyperspace_navigator;
 
 static void BM_fastestRoute(benchmark::State& state) // NOLINT google-runtime-references
@@ -21,11 +23,239 @@ static void BM_fastestRoute(benchmark::State& state) // NOLINT google-runtime-re
     delete[] space;
 }
 
+/***
+ * 2D space where one cell out of four is an obstacle, very slow to cross
+ */
+static std::vector<float> obstacleSpace(uint64_t spaceCells)
+{
+    std::vector<float> space(spaceCells);
+    uint32_t seed = 42;
+    for (float& time : space)
+    {
+        seed = seed * 1103515245U + 12345U;
+        time = (seed >> 16U) % 4 == 0 ? 100.F : static_cast<float>(1 + (seed >> 20U) % 9);
+    }
+    return space;
+}
+
+static void BM_fastestRouteObstacles(benchmark::State& state) // NOLINT google-runtime-references
+{
+    auto dimensionSize = static_cast<uint64_t>(state.range(0));
+    std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({dimensionSize, dimensionSize}));
+    SpaceCell fromCell = map.cell({dimensionSize / 8, dimensionSize / 4});
+    SpaceCell targetCell = map.cell({dimensionSize - dimensionSize / 4, dimensionSize - dimensionSize / 8});
+
+    RouteStatistics statistics;
+    for (auto _ : state)
+    {
+        statistics = RouteStatistics();
+        NavigationPath navigationPath = map.fastestRoute(fromCell, targetCell, &statistics);
+        benchmark::DoNotOptimize(navigationPath);
+    }
+    state.counters["expandedCells"] = static_cast<double>(statistics.expandedCells());
+}
+
+static void BM_fastestRouteLandmarks(benchmark::State& state) // NOLINT google-runtime-references
+{
+    auto dimensionSize = static_cast<uint64_t>(state.range(0));
+    auto numLandmarks = static_cast<uint64_t>(state.range(1));
+    std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({dimensionSize, dimensionSize}));
+    SpaceLandmarks landmarks = map.landmarks(numLandmarks);
+    SpaceCell fromCell = map.cell({dimensionSize / 8, dimensionSize / 4});
+    SpaceCell targetCell = map.cell({dimensionSize - dimensionSize / 4, dimensionSize - dimensionSize / 8});
+
+    RouteStatistics statistics;
+    for (auto _ : state)
+    {
+        statistics = RouteStatistics();
+        NavigationPath navigationPath = map.fastestRoute(fromCell, targetCell, landmarks, &statistics);
+        benchmark::DoNotOptimize(navigationPath);
+    }
+    state.counters["expandedCells"] = static_cast<double>(statistics.expandedCells());
+}
+
+static void BM_fastestRouteCached(benchmark::State& state) // NOLINT google-runtime-references
+{
+    static RouteCache cache(64);
+    const uint64_t dimensionSize = 256;
+    static std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    // Every thread uses the same map, routes are only shared between the users of a map
+    static SpaceMap map = []() {
+        SpaceMap res(space.data(), SpaceLayout({dimensionSize, dimensionSize}));
+        res.useRouteCache(&cache);
+        return res;
+    }();
+    // A few popular routes, asked over and over again
+    auto numRoutes = static_cast<uint64_t>(state.range(0));
+    static std::atomic<uint64_t> nextRoute{0};
+    static uint64_t hits = 0;
+    static uint64_t misses = 0;
+    // Every run starts with a cold cache. The other threads wait for this one when the loop starts.
+    if (state.thread_index == 0)
+    {
+        cache.clear();
+        nextRoute = 0;
+        hits = cache.hits() + cache.subRouteHits();
+        misses = cache.misses();
+    }
+
+    for (auto _ : state)
+    {
+        uint64_t shift = (nextRoute++ % numRoutes) * 8;
+        NavigationPath navigationPath =
+            map.fastestRoute(map.cell({shift, 0}), map.cell({dimensionSize - 1, dimensionSize - 1 - shift}));
+        benchmark::DoNotOptimize(navigationPath);
+    }
+    // Counters of this run only, all the threads have finished the loop here
+    if (state.thread_index == 0)
+    {
+        state.counters["hits"] = static_cast<double>(cache.hits() + cache.subRouteHits() - hits);
+        state.counters["misses"] = static_cast<double>(cache.misses() - misses);
+    }
+}
+
+static void BM_fastestRouteBidirectionalDijkstra(benchmark::State& state) // NOLINT google-runtime-references
+{
+    auto dimensionSize = static_cast<uint64_t>(state.range(0));
+    std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({dimensionSize, dimensionSize}), MovementMode::Bidirectional);
+    // Without landmarks the A* search is plain sequential Dijkstra
+    SpaceLandmarks noLandmarks = map.landmarks(0);
+
+    for (auto _ : state)
+    {
+        NavigationPath navigationPath = map.fastestRoute(map.spaceEnd(), map.spaceStart(), noLandmarks);
+        benchmark::DoNotOptimize(navigationPath);
+    }
+}
+
+static void BM_fastestRouteDeltaStepping(benchmark::State& state) // NOLINT google-runtime-references
+{
+    auto dimensionSize = static_cast<uint64_t>(state.range(0));
+    std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({dimensionSize, dimensionSize}), MovementMode::Bidirectional);
+    map.setDeltaStepping(static_cast<unsigned>(state.range(1)), static_cast<float>(state.range(2)));
+
+    RouteStatistics statistics;
+    for (auto _ : state)
+    {
+        statistics = RouteStatistics();
+        NavigationPath navigationPath = map.fastestRoute(map.spaceEnd(), map.spaceStart(), &statistics);
+        benchmark::DoNotOptimize(navigationPath);
+    }
+    state.counters["expandedCells"] = static_cast<double>(statistics.expandedCells());
+}
+
+/***
+ * Staircase paths of 64 to 128 cells, starting at pseudo random cells of a 1024x1024 space
+ */
+static PathBatch candidatePaths(uint64_t numPaths)
+{
+    const uint64_t dimensionSize = 1024;
+    PathBatch paths;
+    std::vector<uint64_t> offsets;
+    uint32_t seed = 42;
+    for (uint64_t i = 0; i < numPaths; ++i)
+    {
+        seed = seed * 1103515245U + 12345U;
+        uint64_t x = (seed >> 8U) % (dimensionSize / 2);
+        uint64_t y = (seed >> 16U) % (dimensionSize / 2);
+        offsets.clear();
+        for (uint64_t step = 0; step < 64 + (seed >> 24U) % 64; ++step)
+        {
+            offsets.push_back(x + y * dimensionSize);
+            ((seed >> (step % 16U)) & 1U) != 0 ? x++ : y++;
+        }
+        paths.add(offsets.data(), offsets.size());
+    }
+    return paths;
+}
+
+static void BM_evaluatePaths(benchmark::State& state) // NOLINT google-runtime-references
+{
+    const uint64_t dimensionSize = 1024;
+    std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({dimensionSize, dimensionSize}));
+    PathBatch paths = candidatePaths(static_cast<uint64_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        PathBatchResult result = map.evaluate(paths, static_cast<unsigned>(state.range(1)));
+        benchmark::DoNotOptimize(result);
+    }
+    // Reported as items_per_second: paths per second
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.numPaths()));
+}
+
+static void BM_navigationPathTime(benchmark::State& state) // NOLINT google-runtime-references
+{
+    const uint64_t dimensionSize = 1024;
+    std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({dimensionSize, dimensionSize}));
+    PathBatch paths = candidatePaths(static_cast<uint64_t>(state.range(0)));
+    std::vector<NavigationPath> navigationPaths;
+    for (uint64_t path = 0; path < paths.numPaths(); ++path)
+    {
+        NavigationPath navigationPath;
+        for (uint64_t i = paths.numCells(path); i > 0; --i)
+        {
+            navigationPath.add(map.cell(paths.pathOffsets(path)[i - 1]));
+        }
+        navigationPaths.push_back(navigationPath);
+    }
+
+    for (auto _ : state)
+    {
+        for (const NavigationPath& navigationPath : navigationPaths)
+        {
+            benchmark::DoNotOptimize(map.time(navigationPath));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * navigationPaths.size()));
+}
+
+static void BM_landmarks(benchmark::State& state) // NOLINT google-runtime-references
+{
+    auto dimensionSize = static_cast<uint64_t>(state.range(0));
+    auto numLandmarks = static_cast<uint64_t>(state.range(1));
+    std::vector<float> space = obstacleSpace(dimensionSize * dimensionSize);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({dimensionSize, dimensionSize}));
+
+    for (auto _ : state)
+    {
+        SpaceLandmarks landmarks = map.landmarks(numLandmarks);
+        benchmark::DoNotOptimize(landmarks);
+    }
+}
+
 auto main(int argc, char* argv[]) -> int
 {
     benchmark::RegisterBenchmark("BM_fastestRoute", BM_fastestRoute)
         ->Threads(2)->Threads(4)->Threads(8)
         ->Arg(3)->Arg(64)->Arg(1024);                   // NOLINT clang-analyzer-cplusplus.NewDeleteLeaks
+    benchmark::RegisterBenchmark("BM_fastestRouteObstacles", BM_fastestRouteObstacles)
+        ->Arg(64)->Arg(1024);
+    benchmark::RegisterBenchmark("BM_fastestRouteLandmarks", BM_fastestRouteLandmarks)
+        ->Args({64, 4})->Args({1024, 2})->Args({1024, 4})->Args({1024, 8});
+    benchmark::RegisterBenchmark("BM_fastestRouteCached", BM_fastestRouteCached)
+        ->Threads(1)->Threads(4)->Threads(8)
+        ->Arg(16);
+    benchmark::RegisterBenchmark("BM_fastestRouteBidirectionalDijkstra", BM_fastestRouteBidirectionalDijkstra)
+        ->Arg(1024)->Unit(benchmark::kMillisecond);
+    // Arguments: dimension size, threads, delta (0 is the average cell time)
+    benchmark::RegisterBenchmark("BM_fastestRouteDeltaStepping", BM_fastestRouteDeltaStepping)
+        ->Args({1024, 1, 0})->Args({1024, 8, 0})->Args({1024, 32, 0})->Args({1024, 32, 10})->Args({1024, 32, 100})
+        ->UseRealTime()->Unit(benchmark::kMillisecond);
+    // Arguments: paths, threads
+    benchmark::RegisterBenchmark("BM_evaluatePaths", BM_evaluatePaths)
+        ->Args({100000, 1})->Args({100000, 8})->Args({100000, 32})
+        ->UseRealTime()->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_navigationPathTime", BM_navigationPathTime)
+        ->Arg(10000)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_landmarks", BM_landmarks)
+        ->Args({1024, 4})->Args({1024, 8});
 
     benchmark::Initialize(&argc, argv);
     benchmark::RunSpecifiedBenchmarks();
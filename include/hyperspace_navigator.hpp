@@ -4,7 +4,12 @@
 /* The Hyperspace Navigator namespace
  *
  */
+#include "hyperspace_navigator/delta_stepping.hpp"
+#include "hyperspace_navigator/movement_mode.hpp"
+#include "hyperspace_navigator/path_batch.hpp"
+#include "hyperspace_navigator/route_cache.hpp"
 #include "hyperspace_navigator/space_map.hpp"
 #include "hyperspace_navigator/version.hpp"
+#include "hyperspace_navigator/worker_pool.hpp"
 
 #endif
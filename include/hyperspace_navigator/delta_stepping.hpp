@@ -0,0 +1,372 @@
+#ifndef HYPERSPACE_NAVIGATOR_DELTA_STEPPING_HPP
+#define HYPERSPACE_NAVIGATOR_DELTA_STEPPING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "movement_mode.hpp"
+#include "worker_pool.hpp"
+
+namespace hyperspace_navigator {
+
+/***
+ * Parallel delta-stepping shortest time engine (Meyer and Sanders) for spaces with cycles.
+ * Cells are kept in buckets of width delta by their tentative time. All the cells of the lowest bucket are relaxed in
+ * parallel, first through the cheap (light) moves, that can add cells to the same bucket, and then through the
+ * expensive (heavy) ones. The time and the previous cell are packed in a single atomic word, so relaxations are lock
+ * free. That limits the space to less than 2^32 cells, see maxCells().
+ * Each thread owns a partition of the cells, with its own buckets. Updated cells are sent to the outbox of their owner,
+ * that files them into its buckets, so every step of a bucket runs in parallel.
+ */
+class DeltaStepping
+{
+    class Partition
+    {
+      public:
+        std::map<uint64_t, std::vector<uint32_t>> buckets{};
+        // Cells of the current bucket to relax through their light moves
+        std::vector<uint32_t> frontier{};
+        // Cells of the current bucket already relaxed, to relax through their heavy moves
+        std::vector<uint32_t> settled{};
+        // Cells updated by this partition, by owner partition
+        std::vector<std::vector<uint32_t>> outbox{};
+    };
+
+    const float* _space;
+    AdjacentOffsets _adjacentOffsets;
+    float _delta;
+    // Time bits in the high half, previous cell offset in the low half
+    std::vector<std::atomic<uint64_t>> _state;
+    // Stamps are only written by the owner of each cell
+    std::vector<uint64_t> _frontierStamp;
+    std::vector<uint64_t> _settledStamp;
+    uint64_t _currentFrontierStamp = 0;
+    uint64_t _currentSettledStamp = 0;
+    std::vector<Partition> _partitions;
+    uint64_t _processedCells = 0;
+    WorkerPool _pool;
+
+  public:
+    /***
+     * Builds the engine for a space
+     * @param space Time to cross each cell, it must not be negative
+     * @param numCells Number of cells of the space, less than maxCells()
+     * @param adjacentOffsets The allowed moves
+     * @param delta Bucket width, small values mean less wasted relaxations and big ones more parallelism
+     * @param numThreads Number of threads relaxing cells
+     */
+    DeltaStepping(const float* space, uint64_t numCells, AdjacentOffsets adjacentOffsets, float delta,
+                  unsigned numThreads)
+        : _space(space), _adjacentOffsets(std::move(adjacentOffsets)), _delta(delta > 0 ? delta : 1.F),
+          _state(numCells), _frontierStamp(numCells, 0), _settledStamp(numCells, 0),
+          _partitions(std::max(1U, numThreads)), _pool(std::max(1U, numThreads))
+    {
+        for (Partition& partition : _partitions)
+        {
+            partition.outbox.resize(_partitions.size());
+        }
+    }
+
+    DeltaStepping(const DeltaStepping&) = delete;
+    DeltaStepping& operator=(const DeltaStepping&) = delete;
+
+    /***
+     * Biggest number of cells supported
+     */
+    static uint64_t maxCells() { return std::numeric_limits<uint32_t>::max(); }
+
+    /***
+     * Calculates the time from the source cell to every cell, or from every cell to the source cell when reversed.
+     * @param sourceOffset Offset of the source cell
+     * @param targetOffset Stops as soon as the time of this cell is final, use maxCells() to calculate every cell
+     * @param reverse When true, times to navigate to the source cell are calculated instead
+     */
+    void run(uint64_t sourceOffset, uint64_t targetOffset, bool reverse)
+    {
+        const uint64_t infinity = pack(std::numeric_limits<float>::infinity(), maxCells());
+        _pool.run([this, infinity](unsigned threadIndex) {
+            uint64_t first = _state.size() * threadIndex / _pool.numThreads();
+            uint64_t last = _state.size() * (threadIndex + 1) / _pool.numThreads();
+            for (uint64_t offset = first; offset < last; ++offset)
+            {
+                _state[offset].store(infinity, std::memory_order_relaxed);
+            }
+            Partition& partition = _partitions[threadIndex];
+            partition.buckets.clear();
+            partition.frontier.clear();
+            partition.settled.clear();
+            for (std::vector<uint32_t>& outbox : partition.outbox)
+            {
+                outbox.clear();
+            }
+        });
+        _processedCells = 0;
+        _state[sourceOffset].store(pack(0, maxCells()), std::memory_order_relaxed);
+        _partitions[ownerOf(sourceOffset)].buckets[0].push_back(static_cast<uint32_t>(sourceOffset));
+
+        uint64_t bucket = 0;
+        while (nextBucket(&bucket))
+        {
+            if (targetOffset < _state.size() && bucketOf(time(targetOffset)) < bucket)
+            {
+                break;
+            }
+            uint64_t bucketSize = 0;
+            for (const Partition& partition : _partitions)
+            {
+                auto it = partition.buckets.find(bucket);
+                bucketSize += it == partition.buckets.end() ? 0 : it->second.size();
+            }
+            _currentFrontierStamp++;
+            _currentSettledStamp++;
+            forEachPartition(bucketSize, [this, bucket](unsigned partitionIndex) {
+                takeBucket(_partitions[partitionIndex], bucket);
+            });
+
+            uint64_t frontierSize = 0;
+            while ((frontierSize = sizeOf(&Partition::frontier)) > 0)
+            {
+                _processedCells += frontierSize;
+                forEachPartition(frontierSize, [this, reverse](unsigned partitionIndex) {
+                    relax(_partitions[partitionIndex], true, reverse);
+                });
+                _currentFrontierStamp++;
+                forEachPartition(frontierSize, [this, bucket](unsigned partitionIndex) {
+                    collectUpdated(partitionIndex, bucket, true);
+                });
+            }
+            // Heavy moves always land in later buckets
+            const uint64_t settledSize = sizeOf(&Partition::settled);
+            forEachPartition(settledSize, [this, reverse](unsigned partitionIndex) {
+                relax(_partitions[partitionIndex], false, reverse);
+            });
+            forEachPartition(settledSize, [this, bucket](unsigned partitionIndex) {
+                collectUpdated(partitionIndex, bucket, false);
+            });
+        }
+    }
+
+    /***
+     * Time calculated by the last run()
+     * @param offset Offset of the cell
+     * @return The time, infinity if the cell was not reached
+     */
+    float time(uint64_t offset) const
+    {
+        return unpackTime(_state[offset].load(std::memory_order_relaxed));
+    }
+
+    /***
+     * Previous cell in the fastest route found by the last run(): the next one when reversed.
+     * @param offset Offset of the cell
+     * @return The offset of the previous cell or maxCells() if there is none
+     */
+    uint64_t previousOffset(uint64_t offset) const
+    {
+        return _state[offset].load(std::memory_order_relaxed) & 0xFFFFFFFFULL;
+    }
+
+    /***
+     * Number of cells relaxed by the last run(). A cell is counted each time its time improves within its bucket.
+     */
+    uint64_t processedCells() const { return _processedCells; }
+
+  private:
+    static uint64_t pack(float time, uint64_t previous)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &time, sizeof(bits));
+        return (static_cast<uint64_t>(bits) << 32U) | previous;
+    }
+
+    static float unpackTime(uint64_t state)
+    {
+        auto bits = static_cast<uint32_t>(state >> 32U);
+        float time = 0;
+        std::memcpy(&time, &bits, sizeof(time));
+        return time;
+    }
+
+    uint64_t bucketOf(float time) const
+    {
+        const float bucket = time / _delta;
+        if (!(bucket < static_cast<float>(std::numeric_limits<uint64_t>::max() / 2)))
+        {
+            return std::numeric_limits<uint64_t>::max();
+        }
+        return static_cast<uint64_t>(bucket);
+    }
+
+    /***
+     * Partition owning a cell. Cells are dealt in blocks of 64 scattered by a hash, so the cells of any region of the
+     * space are spread between all the partitions.
+     */
+    uint64_t ownerOf(uint64_t offset) const
+    {
+        return (((offset >> 6U) * 0x9E3779B97F4A7C15ULL) >> 32U) % _partitions.size();
+    }
+
+    /***
+     * The lowest bucket with cells in any partition
+     * @return False when every bucket is empty
+     */
+    bool nextBucket(uint64_t* bucket) const
+    {
+        bool found = false;
+        for (const Partition& partition : _partitions)
+        {
+            if (!partition.buckets.empty() && (!found || partition.buckets.begin()->first < *bucket))
+            {
+                *bucket = partition.buckets.begin()->first;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    uint64_t sizeOf(std::vector<uint32_t> Partition::*cells) const
+    {
+        uint64_t size = 0;
+        for (const Partition& partition : _partitions)
+        {
+            size += (partition.*cells).size();
+        }
+        return size;
+    }
+
+    /***
+     * Runs a task for every partition. Waking up the threads is not worth it for a few hundred cells, then the calling
+     * thread runs all of them.
+     */
+    template <typename Task>
+    void forEachPartition(uint64_t numCells, Task task)
+    {
+        if (numCells < std::max<uint64_t>(512, 16 * static_cast<uint64_t>(_partitions.size())))
+        {
+            for (unsigned partitionIndex = 0; partitionIndex < _partitions.size(); ++partitionIndex)
+            {
+                task(partitionIndex);
+            }
+        }
+        else
+        {
+            _pool.run(task);
+        }
+    }
+
+    /***
+     * Moves the cells of a bucket to the frontier, skipping the ones that moved to a lower bucket and repeated ones
+     */
+    void takeBucket(Partition& partition, uint64_t bucket)
+    {
+        partition.settled.clear();
+        auto it = partition.buckets.find(bucket);
+        if (it == partition.buckets.end())
+        {
+            return;
+        }
+        for (uint32_t offset : it->second)
+        {
+            if (bucketOf(time(offset)) == bucket && markStamp(_frontierStamp, _currentFrontierStamp, offset))
+            {
+                partition.frontier.push_back(offset);
+            }
+        }
+        partition.buckets.erase(it);
+    }
+
+    static bool markStamp(std::vector<uint64_t>& stamps, uint64_t stamp, uint64_t offset)
+    {
+        if (stamps[offset] == stamp)
+        {
+            return false;
+        }
+        stamps[offset] = stamp;
+        return true;
+    }
+
+    /***
+     * Lowers the time of a cell. Non negative floats keep their order when compared as integers.
+     */
+    bool improve(uint64_t offset, float newTime, uint64_t previous)
+    {
+        const uint64_t newState = pack(newTime, previous);
+        uint64_t state = _state[offset].load(std::memory_order_relaxed);
+        while ((newState >> 32U) < (state >> 32U))
+        {
+            if (_state[offset].compare_exchange_weak(state, newState, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /***
+     * Relaxes the frontier of a partition through its light moves, or its settled cells through their heavy moves.
+     * The frontier cells become settled.
+     */
+    void relax(Partition& partition, bool light, bool reverse)
+    {
+        const std::vector<uint32_t>& cells = light ? partition.frontier : partition.settled;
+        for (uint32_t offset : cells)
+        {
+            if (light && markStamp(_settledStamp, _currentSettledStamp, offset))
+            {
+                partition.settled.push_back(offset);
+            }
+            const float cellTime = time(offset);
+            _adjacentOffsets.forEach(offset, [&](uint64_t adjacentOffset) {
+                // Entering a cell costs its time, so going back through the route costs the time of the cell left
+                const float moveTime = reverse ? _space[offset] : _space[adjacentOffset];
+                if ((moveTime <= _delta) == light && improve(adjacentOffset, cellTime + moveTime, offset))
+                {
+                    partition.outbox[ownerOf(adjacentOffset)].push_back(static_cast<uint32_t>(adjacentOffset));
+                }
+            });
+        }
+        if (light)
+        {
+            partition.frontier.clear();
+        }
+    }
+
+    /***
+     * Files the cells sent to a partition into its buckets. The ones in the current bucket go to its frontier instead,
+     * unless the light moves of the bucket are done.
+     */
+    void collectUpdated(unsigned partitionIndex, uint64_t bucket, bool light)
+    {
+        Partition& partition = _partitions[partitionIndex];
+        for (Partition& sender : _partitions)
+        {
+            std::vector<uint32_t>& updated = sender.outbox[partitionIndex];
+            for (uint32_t offset : updated)
+            {
+                uint64_t cellBucket = bucketOf(time(offset));
+                if (cellBucket == bucket && light)
+                {
+                    if (markStamp(_frontierStamp, _currentFrontierStamp, offset))
+                    {
+                        partition.frontier.push_back(offset);
+                    }
+                }
+                else
+                {
+                    partition.buckets[cellBucket].push_back(offset);
+                }
+            }
+            updated.clear();
+        }
+    }
+};
+
+} // namespace hyperspace_navigator
+
+#endif
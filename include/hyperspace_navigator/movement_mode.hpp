@@ -0,0 +1,122 @@
+#ifndef HYPERSPACE_NAVIGATOR_MOVEMENT_MODE_HPP
+#define HYPERSPACE_NAVIGATOR_MOVEMENT_MODE_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace hyperspace_navigator {
+
+/***
+ * How a spacecraft can move from a cell to its adjacent ones
+ */
+enum class MovementMode
+{
+    // One cell forward in a single dimension. Routes never go back, so the space has no cycles.
+    ForwardOnly,
+    // One cell forward or backward in a single dimension
+    Bidirectional
+};
+
+/***
+ * Enumerates the offsets of the cells adjacent to a cell in the flat space representation
+ */
+class AdjacentOffsets
+{
+    std::vector<uint64_t> _dimensionSizes;
+    std::vector<uint64_t> _strides;
+    MovementMode _movementMode;
+
+  public:
+    /***
+     * Builds the adjacency of a space
+     * @param dimensionSizes The number of cells for each dimension respectively
+     * @param movementMode Which moves are allowed
+     */
+    AdjacentOffsets(const std::vector<uint64_t>& dimensionSizes, MovementMode movementMode)
+        : _dimensionSizes(dimensionSizes), _strides(), _movementMode(movementMode)
+    {
+        uint64_t stride = 1;
+        for (uint64_t dimensionSize : _dimensionSizes)
+        {
+            _strides.push_back(stride);
+            stride *= dimensionSize;
+        }
+    }
+
+    /***
+     * Calls fn with the offset of every cell adjacent to the cell at offset
+     * @param offset Offset of the cell
+     * @param fn Callable receiving an adjacent offset
+     */
+    template <typename Fn>
+    void forEach(uint64_t offset, Fn fn) const
+    {
+        for (uint64_t i = 0; i < _strides.size(); ++i)
+        {
+            uint64_t index = (offset / _strides[i]) % _dimensionSizes[i];
+            if (index + 1 < _dimensionSizes[i])
+            {
+                fn(offset + _strides[i]);
+            }
+            if (_movementMode == MovementMode::Bidirectional && index > 0)
+            {
+                fn(offset - _strides[i]);
+            }
+        }
+    }
+
+    /***
+     * Determines if every cell of a path is in the space and can be reached from the previous one with a single move.
+     * Only the first cell is decoded into its index, the rest of indexes are updated with each move.
+     * @param offsets Offsets of the path cells
+     * @param count Number of cells of the path
+     * @param index Buffer to store the index of the current cell, to avoid allocations when called for many paths
+     * @return True when the path is valid
+     */
+    bool isPath(const uint64_t* offsets, uint64_t count, std::vector<uint64_t>& index) const
+    {
+        const uint64_t numCells = _strides.empty() ? 0 : _strides.back() * _dimensionSizes.back();
+        if (count == 0 || offsets[0] >= numCells)
+        {
+            return false;
+        }
+        index.resize(_strides.size());
+        for (uint64_t i = 0; i < _strides.size(); ++i)
+        {
+            index[i] = (offsets[0] / _strides[i]) % _dimensionSizes[i];
+        }
+        for (uint64_t cell = 1; cell < count; ++cell)
+        {
+            const bool forward = offsets[cell] > offsets[cell - 1];
+            if (!forward && _movementMode != MovementMode::Bidirectional)
+            {
+                return false;
+            }
+            const uint64_t distance = forward ? offsets[cell] - offsets[cell - 1] : offsets[cell - 1] - offsets[cell];
+            bool moved = false;
+            for (uint64_t i = 0; i < _strides.size() && !moved; ++i)
+            {
+                if (distance == _strides[i] && (forward ? index[i] + 1 < _dimensionSizes[i] : index[i] > 0))
+                {
+                    index[i] = forward ? index[i] + 1 : index[i] - 1;
+                    moved = true;
+                }
+            }
+            if (!moved)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /***
+     * The allowed moves
+     * @return The movement mode
+     */
+    MovementMode movementMode() const { return _movementMode; }
+};
+
+} // namespace hyperspace_navigator
+
+#endif
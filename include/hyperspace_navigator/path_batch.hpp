@@ -0,0 +1,189 @@
+#ifndef HYPERSPACE_NAVIGATOR_PATH_BATCH_HPP
+#define HYPERSPACE_NAVIGATOR_PATH_BATCH_HPP
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace hyperspace_navigator {
+
+/***
+ * Many paths stored in flat buffers: the offsets of all their cells one after the other, and where each path starts.
+ * It is the format to evaluate lots of paths at once, see SpaceMap::evaluate().
+ */
+class PathBatch
+{
+    std::vector<uint64_t> _offsets;
+    std::vector<uint64_t> _pathStarts;
+
+  public:
+    /***
+     * Builds an empty batch
+     */
+    PathBatch() : _offsets(), _pathStarts(1, 0)
+    {
+    }
+
+    /***
+     * Builds a batch from flat buffers
+     * @param offsets Offsets of the cells of every path, one path after the other
+     * @param pathStarts Position in offsets of the first cell of each path, followed by offsets.size()
+     */
+    PathBatch(std::vector<uint64_t> offsets, std::vector<uint64_t> pathStarts)
+        : _offsets(std::move(offsets)), _pathStarts(std::move(pathStarts))
+    {
+        if (_pathStarts.empty() || _pathStarts.front() != 0 || _pathStarts.back() != _offsets.size())
+        {
+            throw std::invalid_argument("Path starts must go from 0 to the number of offsets");
+        }
+        for (uint64_t i = 1; i < _pathStarts.size(); ++i)
+        {
+            if (_pathStarts[i] < _pathStarts[i - 1])
+            {
+                throw std::invalid_argument("Path starts must not decrease");
+            }
+        }
+    }
+
+    /***
+     * Appends a path
+     * @param offsets Offsets of the path cells, in navigation order
+     * @param numCells Number of cells of the path
+     */
+    void add(const uint64_t* offsets, uint64_t numCells)
+    {
+        _offsets.insert(_offsets.end(), offsets, offsets + numCells);
+        _pathStarts.push_back(_offsets.size());
+    }
+
+    /***
+     * Number of paths in the batch
+     * @return The number of paths
+     */
+    uint64_t numPaths() const { return _pathStarts.size() - 1; }
+
+    /***
+     * Number of cells of a path
+     * @param path Path index
+     * @return The number of cells
+     */
+    uint64_t numCells(uint64_t path) const { return _pathStarts[path + 1] - _pathStarts[path]; }
+
+    /***
+     * The offsets of the cells of a path
+     * @param path Path index
+     * @return Pointer to the first of the numCells(path) offsets
+     */
+    const uint64_t* pathOffsets(uint64_t path) const { return _offsets.data() + _pathStarts[path]; }
+
+    /***
+     * Total number of cells of all the paths
+     * @return The number of offsets in the batch
+     */
+    uint64_t totalCells() const { return _offsets.size(); }
+};
+
+/***
+ * Times and validity of each path of a PathBatch
+ */
+class PathBatchResult
+{
+    std::vector<float> _times;
+    std::vector<uint8_t> _valid;
+
+  public:
+    /***
+     * Builds the result for a number of paths, all of them invalid
+     * @param numPaths Number of paths
+     */
+    explicit PathBatchResult(uint64_t numPaths)
+        : _times(numPaths, std::numeric_limits<float>::quiet_NaN()), _valid(numPaths, 0)
+    {
+    }
+
+    /***
+     * Time to cross all the cells of a path
+     * @param path Path index
+     * @return The time, NaN when the path is not valid
+     */
+    float time(uint64_t path) const { return _times[path]; }
+
+    /***
+     * Determines if a path is valid: it is not empty, all its cells are in the map and each one is adjacent to the
+     * previous one
+     * @param path Path index
+     * @return True when the path is valid
+     */
+    bool isValid(uint64_t path) const { return _valid[path] != 0; }
+
+    /***
+     * Number of paths
+     * @return The number of paths
+     */
+    uint64_t numPaths() const { return _times.size(); }
+
+    /***
+     * Sets the result of a path. Different paths can be set from different threads.
+     * @param path Path index
+     * @param time Time of the path
+     */
+    void setValid(uint64_t path, float time)
+    {
+        _times[path] = time;
+        _valid[path] = 1;
+    }
+};
+
+/***
+ * Sum of the times of a list of cells. With AVX2 it gathers and adds 8 cell times per iteration.
+ * @param space Time to cross each cell
+ * @param offsets Offsets of the cells, all of them inside space
+ * @param count Number of offsets
+ * @return The total time
+ */
+inline float gatherTimeSum(const float* space, const uint64_t* offsets, uint64_t count)
+{
+    uint64_t i = 0;
+    float res = 0;
+#if defined(__AVX2__)
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i indexes0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i));
+        __m256i indexes1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i + 4));
+        sum0 = _mm_add_ps(sum0, _mm256_i64gather_ps(space, indexes0, 4));
+        sum1 = _mm_add_ps(sum1, _mm256_i64gather_ps(space, indexes1, 4));
+    }
+    sum0 = _mm_add_ps(sum0, sum1);
+    sum0 = _mm_hadd_ps(sum0, sum0);
+    sum0 = _mm_hadd_ps(sum0, sum0);
+    res = _mm_cvtss_f32(sum0);
+#else
+    // Independent sums, so the loads of the next cells don't wait for the previous additions
+    float sums[4] = {0, 0, 0, 0};
+    for (; i + 4 <= count; i += 4)
+    {
+        sums[0] += space[offsets[i]];
+        sums[1] += space[offsets[i + 1]];
+        sums[2] += space[offsets[i + 2]];
+        sums[3] += space[offsets[i + 3]];
+    }
+    res = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif
+    for (; i < count; ++i)
+    {
+        res += space[offsets[i]];
+    }
+    return res;
+}
+
+} // namespace hyperspace_navigator
+
+#endif
@@ -0,0 +1,445 @@
+#ifndef HYPERSPACE_NAVIGATOR_ROUTE_CACHE_HPP
+#define HYPERSPACE_NAVIGATOR_ROUTE_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hyperspace_navigator {
+
+/***
+ * A route already calculated: the offsets of its cells, in navigation order, and the accumulated time.
+ */
+class CachedRoute
+{
+    std::vector<uint64_t> _offsets;
+    std::vector<float> _accumulatedTimes;
+
+  public:
+    /***
+     * Builds a cached route
+     * @param offsets Offsets of the route cells, from the starting cell to the target cell
+     * @param cellTimes Time to cross each one of the cells in offsets
+     */
+    CachedRoute(std::vector<uint64_t> offsets, const std::vector<float>& cellTimes)
+        : _offsets(std::move(offsets)), _accumulatedTimes(cellTimes.size())
+    {
+        float time = 0;
+        for (uint64_t i = 0; i < cellTimes.size(); ++i)
+        {
+            time += cellTimes[i];
+            _accumulatedTimes[i] = time;
+        }
+    }
+
+    /***
+     * The offsets of the cells of the route
+     * @return The offsets, from the starting cell to the target cell
+     */
+    const std::vector<uint64_t>& offsets() const { return _offsets; }
+
+    /***
+     * Time to cross all the cells of the route
+     * @return The route time
+     */
+    float time() const { return _accumulatedTimes.empty() ? 0.F : _accumulatedTimes.back(); }
+
+    /***
+     * Builds the part of this route that goes from one of its cells to a later one
+     * @param fromOffset Offset of the starting cell
+     * @param toOffset Offset of the target cell
+     * @return The sub route or nullptr when the cells are not in this order in the route
+     */
+    std::shared_ptr<const CachedRoute> subRoute(uint64_t fromOffset, uint64_t toOffset) const
+    {
+        auto fromIt = std::find(_offsets.begin(), _offsets.end(), fromOffset);
+        auto toIt = std::find(fromIt, _offsets.end(), toOffset);
+        if (toIt == _offsets.end())
+        {
+            return nullptr;
+        }
+        auto first = static_cast<uint64_t>(fromIt - _offsets.begin());
+        auto last = static_cast<uint64_t>(toIt - _offsets.begin());
+        std::vector<float> cellTimes;
+        for (uint64_t i = first; i <= last; ++i)
+        {
+            cellTimes.push_back(i == 0 ? _accumulatedTimes[i] : _accumulatedTimes[i] - _accumulatedTimes[i - 1]);
+        }
+        return std::make_shared<const CachedRoute>(std::vector<uint64_t>(fromIt, toIt + 1), cellTimes);
+    }
+};
+
+/***
+ * Identifies a route in the RouteCache: its end points and the map and map version it was calculated with.
+ */
+class RouteKey
+{
+    uint64_t _fromOffset;
+    uint64_t _toOffset;
+    uint64_t _mapId;
+    uint64_t _mapVersion;
+
+  public:
+    /***
+     * Builds a RouteKey
+     * @param fromOffset Offset of the starting cell
+     * @param toOffset Offset of the target cell
+     * @param mapId Identity of the map, see SpaceMap::id()
+     * @param mapVersion Version of the map, see SpaceMap::version()
+     */
+    RouteKey(uint64_t fromOffset, uint64_t toOffset, uint64_t mapId, uint64_t mapVersion)
+        : _fromOffset(fromOffset), _toOffset(toOffset), _mapId(mapId), _mapVersion(mapVersion)
+    {
+    }
+
+    uint64_t fromOffset() const { return _fromOffset; }
+
+    uint64_t toOffset() const { return _toOffset; }
+
+    uint64_t mapId() const { return _mapId; }
+
+    uint64_t mapVersion() const { return _mapVersion; }
+
+    friend bool operator==(const RouteKey& left, const RouteKey& right)
+    {
+        return left._fromOffset == right._fromOffset && left._toOffset == right._toOffset &&
+               left._mapId == right._mapId && left._mapVersion == right._mapVersion;
+    }
+
+    /***
+     * Mixes all the fields of the key
+     * @return The hash of the key
+     */
+    uint64_t hash() const
+    {
+        uint64_t res = _fromOffset * 0x9E3779B97F4A7C15ULL;
+        res = (res ^ (res >> 29U)) + _toOffset * 0xBF58476D1CE4E5B9ULL;
+        res = (res ^ (res >> 31U)) + _mapVersion * 0x94D049BB133111EBULL;
+        res = (res ^ (res >> 29U)) + _mapId * 0x9E3779B97F4A7C15ULL;
+        return res ^ (res >> 32U);
+    }
+};
+
+/***
+ * Helper class to use RouteKey in unordered containers
+ */
+class routeKeyHasher
+{
+  public:
+    std::size_t operator()(const RouteKey& key) const { return static_cast<std::size_t>(key.hash()); }
+};
+
+/***
+ * Size bounded, thread safe cache of routes. It is split in shards, each one with its own lock and least recently
+ * used eviction, so concurrent readers rarely wait for each other.
+ * Routes are kept per map and map version, so a cache can be shared by several maps and routes calculated before
+ * SpaceMap::markModified() are never returned.
+ */
+class RouteCache
+{
+    class Shard
+    {
+      public:
+        using Entry = std::pair<std::shared_ptr<const CachedRoute>, std::list<RouteKey>::iterator>;
+
+        std::mutex mutex{};
+        uint64_t capacity = 0;
+        // Most recently used keys first
+        std::list<RouteKey> usage{};
+        std::unordered_map<RouteKey, Entry, routeKeyHasher> entries{};
+    };
+
+    class CellShard
+    {
+      public:
+        std::mutex mutex{};
+        // Keys of the cached routes that go through each cell
+        std::unordered_map<uint64_t, std::vector<RouteKey>> routes{};
+    };
+
+    std::vector<Shard> _shards;
+    std::vector<CellShard> _cellShards;
+    std::atomic<uint64_t> _hits{0};
+    std::atomic<uint64_t> _subRouteHits{0};
+    std::atomic<uint64_t> _misses{0};
+    std::atomic<uint64_t> _evictions{0};
+
+  public:
+    /***
+     * Builds an empty cache
+     * @param capacity Maximum number of routes to keep, 0 keeps none
+     * @param numShards Number of independently locked shards, should be greater than the number of threads
+     */
+    explicit RouteCache(uint64_t capacity, uint64_t numShards = 16)
+        : _shards(std::max<uint64_t>(1, numShards)), _cellShards(std::max<uint64_t>(1, numShards))
+    {
+        // Spread the remainder, so shard capacities add up to exactly capacity
+        for (uint64_t i = 0; i < _shards.size(); ++i)
+        {
+            _shards[i].capacity = capacity / _shards.size() + (i < capacity % _shards.size() ? 1 : 0);
+        }
+    }
+
+    RouteCache(const RouteCache&) = delete;
+    RouteCache& operator=(const RouteCache&) = delete;
+
+    /***
+     * Looks for a route. When it is not cached, it looks for a cached route that goes through both cells in order:
+     * any part of a fastest route is a fastest route too.
+     * @param fromOffset Offset of the starting cell
+     * @param toOffset Offset of the target cell
+     * @param mapId Identity of the map, see SpaceMap::id()
+     * @param mapVersion Version of the map, see SpaceMap::version()
+     * @return The route or nullptr if it is not in the cache
+     */
+    std::shared_ptr<const CachedRoute> find(uint64_t fromOffset, uint64_t toOffset, uint64_t mapId, uint64_t mapVersion)
+    {
+        RouteKey key(fromOffset, toOffset, mapId, mapVersion);
+        std::shared_ptr<const CachedRoute> route = findEntry(key);
+        if (route)
+        {
+            _hits++;
+            return route;
+        }
+        route = findSubRoute(key);
+        if (route)
+        {
+            _subRouteHits++;
+            return route;
+        }
+        _misses++;
+        return nullptr;
+    }
+
+    /***
+     * Stores a route, evicting the least recently used one of its shard when it is full
+     * @param fromOffset Offset of the starting cell
+     * @param toOffset Offset of the target cell
+     * @param mapId Identity of the map, see SpaceMap::id()
+     * @param mapVersion Version of the map, see SpaceMap::version()
+     * @param route The route to store
+     */
+    void insert(uint64_t fromOffset, uint64_t toOffset, uint64_t mapId, uint64_t mapVersion,
+                std::shared_ptr<const CachedRoute> route)
+    {
+        RouteKey key(fromOffset, toOffset, mapId, mapVersion);
+        if (shardFor(key).capacity == 0)
+        {
+            return;
+        }
+        // Indexed before it can be found, so it can not be evicted (and unindexed) before being indexed
+        indexRoute(key, *route);
+        std::vector<std::pair<RouteKey, std::shared_ptr<const CachedRoute>>> evicted;
+        {
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.entries.count(key) > 0)
+            {
+                // Another thread stored the same route first, this copy is unindexed below
+                evicted.emplace_back(key, route);
+            }
+            else
+            {
+                while (shard.entries.size() >= shard.capacity)
+                {
+                    const RouteKey& oldest = shard.usage.back();
+                    evicted.emplace_back(oldest, shard.entries.at(oldest).first);
+                    shard.entries.erase(oldest);
+                    shard.usage.pop_back();
+                    _evictions++;
+                }
+                shard.usage.push_front(key);
+                shard.entries.emplace(key, Shard::Entry(route, shard.usage.begin()));
+            }
+        }
+        // Cell locks are never taken while holding a shard lock
+        for (const auto& oldRoute : evicted)
+        {
+            unindexRoute(oldRoute.first, *oldRoute.second);
+        }
+    }
+
+    /***
+     * Removes all the routes. Counters are kept. It should not be called while other threads use the cache.
+     */
+    void clear()
+    {
+        for (Shard& shard : _shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.entries.clear();
+            shard.usage.clear();
+        }
+        for (CellShard& cellShard : _cellShards)
+        {
+            std::lock_guard<std::mutex> lock(cellShard.mutex);
+            cellShard.routes.clear();
+        }
+    }
+
+    /***
+     * Number of routes in the cache
+     * @return The number of cached routes
+     */
+    uint64_t size()
+    {
+        uint64_t res = 0;
+        for (Shard& shard : _shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            res += shard.entries.size();
+        }
+        return res;
+    }
+
+    /***
+     * Number of entries of the index used to find sub routes: one per cell of each cached route
+     * @return The number of indexed cells
+     */
+    uint64_t indexSize()
+    {
+        uint64_t res = 0;
+        for (CellShard& cellShard : _cellShards)
+        {
+            std::lock_guard<std::mutex> lock(cellShard.mutex);
+            for (const auto& cellRoutes : cellShard.routes)
+            {
+                res += cellRoutes.second.size();
+            }
+        }
+        return res;
+    }
+
+    /***
+     * Number of lookups answered with a route stored with the same end points
+     */
+    uint64_t hits() const { return _hits; }
+
+    /***
+     * Number of lookups answered with a part of a longer cached route
+     */
+    uint64_t subRouteHits() const { return _subRouteHits; }
+
+    /***
+     * Number of lookups not found in the cache
+     */
+    uint64_t misses() const { return _misses; }
+
+    /***
+     * Number of routes removed to make room for new ones
+     */
+    uint64_t evictions() const { return _evictions; }
+
+  private:
+    Shard& shardFor(const RouteKey& key)
+    {
+        return _shards[key.hash() % _shards.size()];
+    }
+
+    CellShard& cellShardFor(uint64_t cellOffset)
+    {
+        return _cellShards[RouteKey(cellOffset, 0, 0, 0).hash() % _cellShards.size()];
+    }
+
+    /***
+     * Looks for a stored route
+     * @param key Key of the route
+     * @param promote When true the route becomes the most recently used one of its shard
+     */
+    std::shared_ptr<const CachedRoute> findEntry(const RouteKey& key, bool promote = true)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end())
+        {
+            return nullptr;
+        }
+        if (promote)
+        {
+            shard.usage.splice(shard.usage.begin(), shard.usage, it->second.second);
+        }
+        return it->second.first;
+    }
+
+    /***
+     * Looks for a cached route going through both cells. Only the route the sub route is taken from is promoted.
+     */
+    std::shared_ptr<const CachedRoute> findSubRoute(const RouteKey& key)
+    {
+        // The keys are copied, so the cell lock is not held while the routes are scanned
+        std::vector<RouteKey> candidates;
+        {
+            CellShard& cellShard = cellShardFor(key.fromOffset());
+            std::lock_guard<std::mutex> cellLock(cellShard.mutex);
+            auto it = cellShard.routes.find(key.fromOffset());
+            if (it == cellShard.routes.end())
+            {
+                return nullptr;
+            }
+            for (const RouteKey& routeKey : it->second)
+            {
+                if (routeKey.mapId() == key.mapId() && routeKey.mapVersion() == key.mapVersion())
+                {
+                    candidates.push_back(routeKey);
+                }
+            }
+        }
+        for (const RouteKey& routeKey : candidates)
+        {
+            std::shared_ptr<const CachedRoute> route = findEntry(routeKey, false);
+            std::shared_ptr<const CachedRoute> subRoute = route ? route->subRoute(key.fromOffset(), key.toOffset()) : nullptr;
+            if (subRoute)
+            {
+                findEntry(routeKey);
+                return subRoute;
+            }
+        }
+        return nullptr;
+    }
+
+    void indexRoute(const RouteKey& key, const CachedRoute& route)
+    {
+        for (uint64_t cellOffset : route.offsets())
+        {
+            CellShard& cellShard = cellShardFor(cellOffset);
+            std::lock_guard<std::mutex> lock(cellShard.mutex);
+            cellShard.routes[cellOffset].push_back(key);
+        }
+    }
+
+    void unindexRoute(const RouteKey& key, const CachedRoute& route)
+    {
+        for (uint64_t cellOffset : route.offsets())
+        {
+            CellShard& cellShard = cellShardFor(cellOffset);
+            std::lock_guard<std::mutex> lock(cellShard.mutex);
+            auto it = cellShard.routes.find(cellOffset);
+            if (it == cellShard.routes.end())
+            {
+                continue;
+            }
+            // A single occurrence, a key is indexed twice while two threads insert the same route
+            auto keyIt = std::find(it->second.begin(), it->second.end(), key);
+            if (keyIt != it->second.end())
+            {
+                it->second.erase(keyIt);
+            }
+            if (it->second.empty())
+            {
+                cellShard.routes.erase(it);
+            }
+        }
+    }
+};
+
+} // namespace hyperspace_navigator
+
+#endif
@@ -1,10 +1,28 @@
 #ifndef HYPERSPACE_NAVIGATOR_SPACE_MAP_HPP
 #define HYPERSPACE_NAVIGATOR_SPACE_MAP_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
-#include <queue>
-#include <list>
+
+#include "delta_stepping.hpp"
+#include "movement_mode.hpp"
+#include "path_batch.hpp"
+#include "route_cache.hpp"
+#include "worker_pool.hpp"
 
 /***
  * Library to navigate through N-Dimensional Hyperspace
@@ -151,17 +169,10 @@ class SpaceCell
      */
     SpaceCell(uint64_t spaceOffset, SpaceLayout& layout) : _layout(layout)
     {
-        uint64_t currDimension = layout.numDimensions() - 1;
         _index = SpaceIndex(layout.numDimensions(), 0);
-        while (currDimension > 0)
+        for (uint64_t dimension = 0; dimension < layout.numDimensions(); ++dimension)
         {
-            uint64_t subDimSize = layout.subDimensionLayoutSize(currDimension);
-            _index[currDimension] = spaceOffset / subDimSize;
-            currDimension--;
-            if (currDimension == 0)
-            {
-                _index[currDimension] = spaceOffset % subDimSize;
-            }
+            _index[dimension] = (spaceOffset / layout.dimensionOffset(dimension)) % layout.dimensionSize(dimension);
         }
     }
 
@@ -172,11 +183,11 @@ class SpaceCell
     uint64_t spaceOffset() const
     {
         uint64_t res = 0;
-        uint64_t currentDimension = 0;
-        SpaceIndex::const_iterator it;
-        for (it = _index.begin(); it < _index.end(); ++it)
+        uint64_t dimensionOffset = 1;
+        for (uint64_t dimension = 0; dimension < _index.size(); ++dimension)
         {
-            res += *it * _layout.dimensionOffset(currentDimension++);
+            res += _index[dimension] * dimensionOffset;
+            dimensionOffset *= _layout.dimensionSize(dimension);
         }
         return res;
     }
@@ -194,9 +205,10 @@ class SpaceCell
 
     /***
      * Calculates the cells that are adjacent to the current cell. Adjacent cells have allways hamming distance of 1
+     * @param movementMode Whether cells one step backward are adjacent too
      * @return A vector with all the adjacent cells.
      */
-    std::vector<SpaceCell> getAdjacentCells() const
+    std::vector<SpaceCell> getAdjacentCells(MovementMode movementMode = MovementMode::ForwardOnly) const
     {
         std::vector<SpaceCell> cellsList;
         // Hamming distance of 1
@@ -208,6 +220,12 @@ class SpaceCell
                 cellIndex[i] = cellIndex[i] + 1;
                 cellsList.emplace_back(cellIndex, _layout);
             }
+            cellIndex = _index;
+            if (movementMode == MovementMode::Bidirectional && cellIndex[i] > 0)
+            {
+                cellIndex[i] = cellIndex[i] - 1;
+                cellsList.emplace_back(cellIndex, _layout);
+            }
         }
         return cellsList;
     }
@@ -369,22 +387,372 @@ class offsetAndTimeComparator
 };
 
 
+/***
+ * Counters collected while searching a route. Pass one to fastestRoute to know how much work the search did.
+ */
+class RouteStatistics
+{
+    uint64_t _expandedCells = 0;
+
+  public:
+    /***
+     * Registers that the search has settled one more cell
+     */
+    void addExpandedCell() { _expandedCells++; }
+
+    /***
+     * Registers that the search has settled several cells
+     * @param count Number of cells
+     */
+    void addExpandedCells(uint64_t count) { _expandedCells += count; }
+
+    /***
+     * Number of cells settled by the search
+     * @return The number of expanded cells
+     */
+    uint64_t expandedCells() const { return _expandedCells; }
+};
+
+/***
+ * Precalculated ALT (A*, Landmarks and Triangle inequality) data for a static SpaceMap.
+ * For every landmark it stores the time from the landmark to every cell (forward) and from every cell to the
+ * landmark (backward). Build it with SpaceMap::landmarks() and rebuild it whenever the space times change.
+ * The layout, movement mode and a checksum of the space times are kept with them, so they are never used with a map
+ * they were not calculated for, even after being saved and loaded.
+ */
+class SpaceLandmarks
+{
+    std::vector<uint64_t> _dimensionSizes;
+    uint64_t _numCells;
+    MovementMode _movementMode;
+    uint64_t _spaceChecksum;
+    std::vector<uint64_t> _offsets;
+    // Both fields are stored cell major: the times of all the landmarks for a cell are contiguous
+    std::vector<float> _forwardTimes;
+    std::vector<float> _backwardTimes;
+
+  public:
+    /***
+     * Builds the landmarks given their precalculated times. Please use SpaceMap::landmarks() to build them.
+     * @param dimensionSizes The number of cells for each dimension of the map the landmarks belong to
+     * @param movementMode Movement mode of the map when the times were calculated
+     * @param spaceChecksum Checksum of the space times when the times were calculated, see SpaceMap::spaceChecksum()
+     * @param offsets Offsets of the landmark cells
+     * @param forwardTimes Time from each landmark to each cell, indexed by cell * numLandmarks + landmark
+     * @param backwardTimes Time from each cell to each landmark, indexed by cell * numLandmarks + landmark
+     */
+    SpaceLandmarks(std::vector<uint64_t> dimensionSizes, MovementMode movementMode, uint64_t spaceChecksum,
+                   std::vector<uint64_t> offsets, std::vector<float> forwardTimes, std::vector<float> backwardTimes)
+        : _dimensionSizes(std::move(dimensionSizes)), _numCells(1), _movementMode(movementMode),
+          _spaceChecksum(spaceChecksum), _offsets(std::move(offsets)), _forwardTimes(std::move(forwardTimes)),
+          _backwardTimes(std::move(backwardTimes))
+    {
+        for (uint64_t dimensionSize : _dimensionSizes)
+        {
+            _numCells *= dimensionSize;
+        }
+        if (_forwardTimes.size() != _numCells * _offsets.size() || _backwardTimes.size() != _forwardTimes.size())
+        {
+            throw std::invalid_argument("Landmark times do not match the number of cells and landmarks");
+        }
+    }
+
+    /***
+     * Number of landmarks
+     * @return The number of landmarks
+     */
+    uint64_t numLandmarks() const { return _offsets.size(); }
+
+    /***
+     * Number of cells of the map these landmarks were calculated for
+     * @return The number of cells
+     */
+    uint64_t numCells() const { return _numCells; }
+
+    /***
+     * Layout of the map these landmarks were calculated for
+     * @return The number of cells for each dimension
+     */
+    const std::vector<uint64_t>& dimensionSizes() const { return _dimensionSizes; }
+
+    /***
+     * Movement mode of the map these landmarks were calculated for
+     * @return The movement mode
+     */
+    MovementMode movementMode() const { return _movementMode; }
+
+    /***
+     * Checksum of the space times these landmarks were calculated for, see SpaceMap::spaceChecksum()
+     * @return The checksum
+     */
+    uint64_t spaceChecksum() const { return _spaceChecksum; }
+
+    /***
+     * The offset in the flat space of a landmark
+     * @param landmark Landmark index
+     * @return The offset of the landmark cell
+     */
+    uint64_t offset(uint64_t landmark) const { return _offsets[landmark]; }
+
+    /***
+     * Time to navigate from a landmark to a cell
+     * @param landmark Landmark index
+     * @param cellOffset Offset of the cell
+     * @return The time, infinity when the cell can not be reached from the landmark
+     */
+    float forwardTime(uint64_t landmark, uint64_t cellOffset) const
+    {
+        return _forwardTimes[cellOffset * numLandmarks() + landmark];
+    }
+
+    /***
+     * Time to navigate from a cell to a landmark
+     * @param landmark Landmark index
+     * @param cellOffset Offset of the cell
+     * @return The time, infinity when the landmark can not be reached from the cell
+     */
+    float backwardTime(uint64_t landmark, uint64_t cellOffset) const
+    {
+        return _backwardTimes[cellOffset * numLandmarks() + landmark];
+    }
+
+    /***
+     * Lower bound of the time to navigate between two cells using the triangle inequality on every landmark.
+     * @param cellOffset Offset of the starting cell
+     * @param targetOffset Offset of the target cell
+     * @return A time that is never greater than the fastest route time between the cells
+     */
+    float lowerBound(uint64_t cellOffset, uint64_t targetOffset) const
+    {
+        const uint64_t count = numLandmarks();
+        const float* forwardCell = _forwardTimes.data() + cellOffset * count;
+        const float* forwardTarget = _forwardTimes.data() + targetOffset * count;
+        const float* backwardCell = _backwardTimes.data() + cellOffset * count;
+        const float* backwardTarget = _backwardTimes.data() + targetOffset * count;
+        float bound = 0;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            // d(L, target) <= d(L, cell) + d(cell, target)
+            if (!std::isinf(forwardTarget[i]) && !std::isinf(forwardCell[i]))
+            {
+                bound = std::max(bound, forwardTarget[i] - forwardCell[i]);
+            }
+            // d(cell, L) <= d(cell, target) + d(target, L)
+            if (!std::isinf(backwardCell[i]) && !std::isinf(backwardTarget[i]))
+            {
+                bound = std::max(bound, backwardCell[i] - backwardTarget[i]);
+            }
+        }
+        return bound;
+    }
+
+    /***
+     * Writes the landmarks in binary format, to be loaded later with load()
+     * @param stream Output stream, it should be opened in binary mode
+     */
+    void save(std::ostream& stream) const
+    {
+        const uint64_t count = numLandmarks();
+        const uint64_t numDimensions = _dimensionSizes.size();
+        const auto movementMode = static_cast<uint64_t>(_movementMode);
+        stream.write(fileTag(), fileTagSize);
+        writeValues(stream, &numDimensions, 1);
+        writeValues(stream, _dimensionSizes.data(), numDimensions);
+        writeValues(stream, &movementMode, 1);
+        writeValues(stream, &_spaceChecksum, 1);
+        writeValues(stream, &count, 1);
+        writeValues(stream, _offsets.data(), _offsets.size());
+        writeValues(stream, _forwardTimes.data(), _forwardTimes.size());
+        writeValues(stream, _backwardTimes.data(), _backwardTimes.size());
+        if (!stream)
+        {
+            throw std::runtime_error("Unable to write space landmarks");
+        }
+    }
+
+    /***
+     * Reads landmarks previously written with save()
+     * @param stream Input stream, it should be opened in binary mode
+     * @return The loaded landmarks
+     */
+    static SpaceLandmarks load(std::istream& stream)
+    {
+        char tag[fileTagSize];
+        stream.read(tag, fileTagSize);
+        if (!stream || !std::equal(tag, tag + fileTagSize, fileTag()))
+        {
+            throw std::runtime_error("Invalid space landmarks data");
+        }
+        uint64_t numDimensions = 0;
+        readValues(stream, &numDimensions, 1);
+        if (numDimensions > remainingSize(stream) / sizeof(uint64_t))
+        {
+            throw std::runtime_error("Invalid space landmarks data");
+        }
+        std::vector<uint64_t> dimensionSizes(numDimensions);
+        readValues(stream, dimensionSizes.data(), numDimensions);
+        uint64_t numCells = 1;
+        for (uint64_t dimensionSize : dimensionSizes)
+        {
+            if (dimensionSize == 0 || numCells > std::numeric_limits<uint64_t>::max() / dimensionSize)
+            {
+                throw std::runtime_error("Invalid space landmarks data");
+            }
+            numCells *= dimensionSize;
+        }
+        uint64_t movementMode = 0;
+        uint64_t spaceChecksum = 0;
+        uint64_t count = 0;
+        readValues(stream, &movementMode, 1);
+        readValues(stream, &spaceChecksum, 1);
+        readValues(stream, &count, 1);
+        if (movementMode > static_cast<uint64_t>(MovementMode::Bidirectional))
+        {
+            throw std::runtime_error("Invalid space landmarks data");
+        }
+        // Validate the sizes before allocating, a corrupt header could ask for any amount of memory
+        const uint64_t maxValues = std::numeric_limits<uint64_t>::max() / (2 * sizeof(float));
+        if (count > maxValues / sizeof(uint64_t) || (count > 0 && numCells > maxValues / count))
+        {
+            throw std::runtime_error("Invalid space landmarks data");
+        }
+        const uint64_t dataSize = count * sizeof(uint64_t) + 2 * numCells * count * sizeof(float);
+        if (dataSize < count * sizeof(uint64_t) || dataSize > remainingSize(stream))
+        {
+            throw std::runtime_error("Invalid space landmarks data");
+        }
+        std::vector<uint64_t> offsets(count);
+        std::vector<float> forwardTimes(numCells * count);
+        std::vector<float> backwardTimes(numCells * count);
+        readValues(stream, offsets.data(), offsets.size());
+        readValues(stream, forwardTimes.data(), forwardTimes.size());
+        readValues(stream, backwardTimes.data(), backwardTimes.size());
+        return SpaceLandmarks(std::move(dimensionSizes), static_cast<MovementMode>(movementMode), spaceChecksum,
+                              std::move(offsets), std::move(forwardTimes), std::move(backwardTimes));
+    }
+
+  private:
+    static constexpr std::streamsize fileTagSize = 8;
+
+    static const char* fileTag() { return "HSNLMK03"; }
+
+    /***
+     * Bytes left to read in the stream, or the biggest possible size when the stream can not tell
+     */
+    static uint64_t remainingSize(std::istream& stream)
+    {
+        const std::istream::pos_type position = stream.tellg();
+        if (position == std::istream::pos_type(-1))
+        {
+            return std::numeric_limits<uint64_t>::max();
+        }
+        stream.seekg(0, std::ios::end);
+        const std::istream::pos_type end = stream.tellg();
+        stream.seekg(position);
+        if (end == std::istream::pos_type(-1) || !stream)
+        {
+            stream.clear();
+            stream.seekg(position);
+            return std::numeric_limits<uint64_t>::max();
+        }
+        return static_cast<uint64_t>(end - position);
+    }
+
+    template <typename T>
+    static void writeValues(std::ostream& stream, const T* values, uint64_t count)
+    {
+        stream.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+
+    template <typename T>
+    static void readValues(std::istream& stream, T* values, uint64_t count)
+    {
+        stream.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        if (!stream)
+        {
+            throw std::runtime_error("Truncated space landmarks data");
+        }
+    }
+};
+
 /***
  * The representation of a map of the entire space.
  */
 class SpaceMap
 {
   private:
+    /***
+     * Delta-stepping engine built on first use. It is shared by the copies of the map and reused by every route, so
+     * the worker threads are started once and routes are calculated one at a time.
+     */
+    struct DeltaSteppingSlot
+    {
+        std::mutex mutex;
+        std::unique_ptr<DeltaStepping> engine;
+
+        DeltaSteppingSlot() : mutex(), engine() {}
+    };
+
+    /***
+     * Identity of a map in the route caches. Every map gets a new one, copies included, as their versions and
+     * movement modes change independently.
+     */
+    class MapId
+    {
+        uint64_t _value;
+
+        static uint64_t next()
+        {
+            static std::atomic<uint64_t> counter{0};
+            return counter++;
+        }
+
+      public:
+        MapId() : _value(next()) {}
+
+        MapId(const MapId& /*other*/) : _value(next()) {}
+
+        MapId& operator=(const MapId& /*other*/)
+        {
+            _value = next();
+            return *this;
+        }
+
+        uint64_t value() const { return _value; }
+    };
+
+    /***
+     * Checksum of the space times, calculated on first use after each markModified()
+     */
+    struct ChecksumSlot
+    {
+        std::mutex mutex;
+        bool calculated;
+        uint64_t checksum;
+
+        ChecksumSlot() : mutex(), calculated(false), checksum(0) {}
+    };
+
     float* _space;
     SpaceLayout _layout;
+    MovementMode _movementMode;
+    uint64_t _version = 0;
+    RouteCache* _routeCache = nullptr;
+    unsigned _numThreads = 0;
+    float _delta = 0;
+    std::shared_ptr<DeltaSteppingSlot> _deltaStepping = std::make_shared<DeltaSteppingSlot>();
+    std::shared_ptr<ChecksumSlot> _checksum = std::make_shared<ChecksumSlot>();
+    MapId _id;
 
   public:
     /***
      * Construct a SpaceMap given a space memory pointer and its layout
      * @param space Pointer to space representation
      * @param layout How is the space layed out (See: SpaceLayout)
+     * @param movementMode Allowed moves between adjacent cells (See: MovementMode)
      */
-    SpaceMap(float* space, const SpaceLayout& layout) : _space(space), _layout(layout)
+    SpaceMap(float* space, const SpaceLayout& layout, MovementMode movementMode = MovementMode::ForwardOnly)
+        : _space(space), _layout(layout), _movementMode(movementMode)
     {
     }
 
@@ -471,6 +839,67 @@ class SpaceMap
         return timeResult;
     }
 
+    /***
+     * Validates and calculates the time of many paths at once, splitting them between threads.
+     * Much faster than calling time(const NavigationPath&) for each one of them.
+     * @param paths The paths, their cells must be adjacent following movementMode()
+     * @param numThreads Number of threads, 0 to use all the hardware threads
+     * @return The time and validity of each path
+     */
+    PathBatchResult evaluate(const PathBatch& paths, unsigned numThreads = 0)
+    {
+        const AdjacentOffsets adjacent = adjacentOffsets();
+        const uint64_t numPaths = paths.numPaths();
+        PathBatchResult result(numPaths);
+        uint64_t threads = numThreads > 0 ? numThreads : std::max(1U, std::thread::hardware_concurrency());
+        threads = std::min<uint64_t>(threads, 1 + paths.totalCells() / 65536);
+        WorkerPool pool(static_cast<unsigned>(threads));
+        pool.run([&](unsigned threadIndex) {
+            const uint64_t first = numPaths * threadIndex / threads;
+            const uint64_t last = numPaths * (threadIndex + 1) / threads;
+            std::vector<uint64_t> index;
+            for (uint64_t path = first; path < last; ++path)
+            {
+                const uint64_t* offsets = paths.pathOffsets(path);
+                const uint64_t pathCells = paths.numCells(path);
+                if (adjacent.isPath(offsets, pathCells, index))
+                {
+                    result.setValid(path, gatherTimeSum(_space, offsets, pathCells));
+                }
+            }
+        });
+        return result;
+    }
+
+    /***
+     * Builds a PathBatch from the indexes of the cells of the paths
+     * @param indexes numDimensions() values for each cell, one cell after the other
+     * @param pathStarts Position of the first cell of each path, counted in cells, followed by the total of cells
+     * @return The batch with the offsets of the cells
+     */
+    PathBatch pathBatch(const std::vector<uint64_t>& indexes, std::vector<uint64_t> pathStarts)
+    {
+        const uint64_t numDimensions = _layout.numDimensions();
+        const std::vector<uint64_t> strides = dimensionStrides();
+        if (numDimensions == 0 || indexes.size() % numDimensions != 0)
+        {
+            throw std::invalid_argument("Indexes must have a value for each dimension of each cell");
+        }
+        std::vector<uint64_t> offsets(indexes.size() / numDimensions);
+        for (uint64_t i = 0; i < offsets.size(); ++i)
+        {
+            uint64_t offset = 0;
+            for (uint64_t dimension = 0; dimension < numDimensions; ++dimension)
+            {
+                const uint64_t index = indexes[i * numDimensions + dimension];
+                // Out of range indexes give an offset out of the map, so the path is not valid
+                offset += index < _layout.dimensionSize(dimension) ? index * strides[dimension] : numCells();
+            }
+            offsets[i] = offset;
+        }
+        return PathBatch(std::move(offsets), std::move(pathStarts));
+    }
+
     /***
      * Builds a navigation path given a list of indexes
      * @param indexes The indexes of the NavigationPath
@@ -490,55 +919,511 @@ class SpaceMap
      * Given a source and destination Cells it returns the fastest route to navigate from the source to the destination
      * @param fromCell Starting point SpaceCell
      * @param targetCell End point SpaceCell
+     * @param statistics Optional counters to fill with the work done by the search
      * @return A navigation path containing all the cells to navigate in order to follow the fastest route
      */
-    NavigationPath fastestRoute(SpaceCell fromCell, SpaceCell targetCell)
+    NavigationPath fastestRoute(SpaceCell fromCell, SpaceCell targetCell, RouteStatistics* statistics = nullptr)
+    {
+        return routeThroughCache(fromCell, targetCell, [&]() {
+            if (_movementMode == MovementMode::Bidirectional && numCells() <= DeltaStepping::maxCells())
+            {
+                return deltaSteppingRoute(fromCell, targetCell, statistics);
+            }
+            return searchRoute(fromCell, targetCell, [](uint64_t) { return 0.F; }, statistics);
+        });
+    }
+
+    /***
+     * Same as fastestRoute(fromCell, targetCell) but guided by precalculated landmarks (A* with ALT lower bounds).
+     * The resulting route is still the fastest one, but far less cells are explored.
+     * @param fromCell Starting point SpaceCell
+     * @param targetCell End point SpaceCell
+     * @param landmarks Landmarks calculated with landmarks() for a map with this layout, movement mode and times
+     * @param statistics Optional counters to fill with the work done by the search
+     * @return A navigation path containing all the cells to navigate in order to follow the fastest route
+     */
+    NavigationPath fastestRoute(SpaceCell fromCell, SpaceCell targetCell, const SpaceLandmarks& landmarks,
+                                RouteStatistics* statistics = nullptr)
+    {
+        if (landmarks.dimensionSizes() != dimensionSizes())
+        {
+            throw std::invalid_argument("Landmarks were not calculated for this space map");
+        }
+        // Times calculated with other moves or other space times would overestimate the bounds
+        if (landmarks.movementMode() != _movementMode || landmarks.spaceChecksum() != spaceChecksum())
+        {
+            throw std::invalid_argument("Landmarks were calculated for other space times or movement mode");
+        }
+        const uint64_t targetOffset = targetCell.spaceOffset();
+        return routeThroughCache(fromCell, targetCell, [&]() {
+            return searchRoute(
+                fromCell, targetCell,
+                [&landmarks, targetOffset](uint64_t offset) { return landmarks.lowerBound(offset, targetOffset); },
+                statistics);
+        });
+    }
+
+    /***
+     * Makes fastestRoute look for the routes in a cache before calculating them, and store them there afterwards.
+     * The cache is not owned by the map and it must outlive it. It can be shared by threads and by several maps, each
+     * map only gets the routes it stored, see id().
+     * @param routeCache The cache to use, nullptr to stop using it
+     */
+    void useRouteCache(RouteCache* routeCache)
     {
-        std::vector<float> timeList(numCells(), std::numeric_limits<float>::max());
-        std::vector<SpaceCell> previousCell(numCells(), SpaceCell::undefined());
+        _routeCache = routeCache;
+    }
+
+    /***
+     * Declares that the space times have been modified, so routes calculated before are no longer valid.
+     * Cached routes from previous versions are never returned.
+     */
+    void markModified()
+    {
+        _version++;
+        _checksum = std::make_shared<ChecksumSlot>();
+    }
+
+    /***
+     * Changes the allowed moves. Routes calculated before are no longer valid, see markModified().
+     * With MovementMode::Bidirectional routes are calculated with the parallel delta-stepping engine.
+     * @param movementMode The allowed moves
+     */
+    void setMovementMode(MovementMode movementMode)
+    {
+        _movementMode = movementMode;
+        _deltaStepping = std::make_shared<DeltaSteppingSlot>();
+        markModified();
+    }
+
+    /***
+     * The allowed moves
+     * @return The movement mode
+     */
+    MovementMode movementMode() const
+    {
+        return _movementMode;
+    }
+
+    /***
+     * Tunes the delta-stepping engine used with MovementMode::Bidirectional. The engine is rebuilt on next use.
+     * Small maps get less threads than asked, one for each 16384 cells, see deltaSteppingThreads().
+     * @param numThreads Maximum number of threads, 0 to use all the hardware threads
+     * @param delta Bucket width in time units, 0 to use the average cell time
+     */
+    void setDeltaStepping(unsigned numThreads, float delta = 0)
+    {
+        _numThreads = numThreads;
+        _delta = delta;
+        _deltaStepping = std::make_shared<DeltaSteppingSlot>();
+    }
+
+    /***
+     * Number of threads used by the delta-stepping engine: the ones asked with setDeltaStepping(), but no more than
+     * one for each 16384 cells, as waking them up would cost more than the work they share.
+     * @return The number of threads
+     */
+    unsigned deltaSteppingThreads()
+    {
+        unsigned numThreads = _numThreads > 0 ? _numThreads : std::max(1U, std::thread::hardware_concurrency());
+        return static_cast<unsigned>(std::min<uint64_t>(numThreads, 1 + numCells() / 16384));
+    }
+
+    /***
+     * The version of the space times, incremented each time markModified() is called
+     * @return The map version
+     */
+    uint64_t version() const
+    {
+        return _version;
+    }
+
+    /***
+     * Identifies this map in the route caches. It is unique for each map object, copies get a new one.
+     * @return The map identity
+     */
+    uint64_t id() const
+    {
+        return _id.value();
+    }
+
+    /***
+     * FNV-1a hash of the space times, used to tell if landmarks were calculated for them. It is calculated once and
+     * then reused until markModified() is called.
+     * @return The checksum
+     */
+    uint64_t spaceChecksum()
+    {
+        std::shared_ptr<ChecksumSlot> slot = _checksum;
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (!slot->calculated)
+        {
+            uint64_t checksum = 14695981039346656037ULL;
+            const uint64_t cellCount = numCells();
+            for (uint64_t offset = 0; offset < cellCount; ++offset)
+            {
+                uint32_t bits = 0;
+                std::memcpy(&bits, &_space[offset], sizeof(bits));
+                checksum = (checksum ^ bits) * 1099511628211ULL;
+            }
+            slot->checksum = checksum;
+            slot->calculated = true;
+        }
+        return slot->checksum;
+    }
+
+    /***
+     * Precalculates the landmarks used to speed up fastestRoute on this map.
+     * spaceStart() and spaceEnd() are picked first, the rest are the cells farthest from the already picked ones.
+     * @param numLandmarks Number of landmarks to pick, more landmarks give better guidance but need more memory
+     * @return The landmarks with their forward and backward times
+     */
+    SpaceLandmarks landmarks(uint64_t numLandmarks)
+    {
+        const uint64_t cellCount = numCells();
+        const uint64_t count = std::min(numLandmarks, cellCount);
+        std::vector<uint64_t> offsets;
+        std::vector<float> forwardTimes(cellCount * count);
+        std::vector<float> backwardTimes(cellCount * count);
+        std::vector<float> nearestTime(cellCount, std::numeric_limits<float>::infinity());
+        std::vector<bool> isLandmark(cellCount, false);
+        std::vector<float> forwardField;
+        std::vector<float> backwardField;
+        std::shared_ptr<DeltaSteppingSlot> slot = _deltaStepping;
+        std::unique_lock<std::mutex> lock(slot->mutex, std::defer_lock);
+        DeltaStepping* engine = nullptr;
+        if (_movementMode != MovementMode::ForwardOnly && cellCount <= DeltaStepping::maxCells())
+        {
+            lock.lock();
+            engine = &deltaSteppingEngine(*slot);
+        }
+
+        while (offsets.size() < count)
+        {
+            uint64_t landmarkOffset = 0;
+            if (offsets.size() == 1 && !isLandmark[spaceEnd().spaceOffset()])
+            {
+                landmarkOffset = spaceEnd().spaceOffset();
+            }
+            else if (!offsets.empty())
+            {
+                // Farthest point: the cell with the greatest time to its nearest landmark
+                bool found = false;
+                for (uint64_t offset = 0; offset < cellCount; ++offset)
+                {
+                    if (!isLandmark[offset] && (!found || nearestTime[offset] > nearestTime[landmarkOffset]))
+                    {
+                        landmarkOffset = offset;
+                        found = true;
+                    }
+                }
+            }
+            const uint64_t landmark = offsets.size();
+            offsets.push_back(landmarkOffset);
+            isLandmark[landmarkOffset] = true;
+
+            if (engine != nullptr)
+            {
+                deltaSteppingTimeField(*engine, landmarkOffset, false, forwardField);
+                deltaSteppingTimeField(*engine, landmarkOffset, true, backwardField);
+            }
+            else if (_movementMode == MovementMode::ForwardOnly)
+            {
+                forwardTimeField(landmarkOffset, forwardField);
+                backwardTimeField(landmarkOffset, backwardField);
+            }
+            else
+            {
+                dijkstraTimeField(landmarkOffset, false, forwardField);
+                dijkstraTimeField(landmarkOffset, true, backwardField);
+            }
+            for (uint64_t offset = 0; offset < cellCount; ++offset)
+            {
+                forwardTimes[offset * count + landmark] = forwardField[offset];
+                backwardTimes[offset * count + landmark] = backwardField[offset];
+                nearestTime[offset] = std::min(nearestTime[offset], std::min(forwardField[offset], backwardField[offset]));
+            }
+        }
+        return SpaceLandmarks(dimensionSizes(), _movementMode, spaceChecksum(), std::move(offsets),
+                              std::move(forwardTimes), std::move(backwardTimes));
+    }
+
+  private:
+    float spaceTime(SpaceCell cell)
+    {
+        return _space[cell.spaceOffset()];
+    }
+
+    static uint64_t undefinedOffset()
+    {
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    /***
+     * Offset increment to move one cell forward on each dimension
+     */
+    std::vector<uint64_t> dimensionStrides() const
+    {
+        std::vector<uint64_t> strides;
+        for (uint64_t i = 0; i < _layout.numDimensions(); ++i)
+        {
+            strides.push_back(_layout.dimensionOffset(i));
+        }
+        return strides;
+    }
+
+    std::vector<uint64_t> dimensionSizes() const
+    {
+        std::vector<uint64_t> sizes;
+        for (uint64_t i = 0; i < _layout.numDimensions(); ++i)
+        {
+            sizes.push_back(_layout.dimensionSize(i));
+        }
+        return sizes;
+    }
+
+    AdjacentOffsets adjacentOffsets() const
+    {
+        return AdjacentOffsets(dimensionSizes(), _movementMode);
+    }
+
+    /***
+     * The delta-stepping engine of the slot, built with deltaSteppingThreads() threads and the configured delta if
+     * there is none yet. The slot must be locked.
+     */
+    DeltaStepping& deltaSteppingEngine(DeltaSteppingSlot& slot)
+    {
+        if (slot.engine)
+        {
+            return *slot.engine;
+        }
+        const uint64_t cellCount = numCells();
+        float delta = _delta;
+        if (delta <= 0)
+        {
+            double totalTime = 0;
+            for (uint64_t offset = 0; offset < cellCount; ++offset)
+            {
+                totalTime += static_cast<double>(_space[offset]);
+            }
+            delta = static_cast<float>(totalTime / static_cast<double>(std::max<uint64_t>(1, cellCount)));
+        }
+        slot.engine.reset(new DeltaStepping(_space, cellCount, adjacentOffsets(), delta, deltaSteppingThreads()));
+        return *slot.engine;
+    }
+
+    /***
+     * Fastest route calculated with the delta-stepping engine
+     * @return The offsets of the route, from fromCell to targetCell
+     */
+    std::vector<uint64_t> deltaSteppingRoute(const SpaceCell& fromCell, const SpaceCell& targetCell,
+                                             RouteStatistics* statistics)
+    {
+        std::shared_ptr<DeltaSteppingSlot> slot = _deltaStepping;
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        DeltaStepping& engine = deltaSteppingEngine(*slot);
+        const uint64_t targetOffset = targetCell.spaceOffset();
+        engine.run(fromCell.spaceOffset(), targetOffset, false);
+        if (statistics != nullptr)
+        {
+            statistics->addExpandedCells(engine.processedCells());
+        }
+        std::vector<uint64_t> path;
+        uint64_t uOffset = targetOffset;
+        while (uOffset != DeltaStepping::maxCells() && path.size() < numCells())
+        {
+            path.push_back(uOffset);
+            uOffset = engine.previousOffset(uOffset);
+        }
+        std::reverse(path.begin(), path.end());
+
+        return path;
+    }
+
+    void deltaSteppingTimeField(DeltaStepping& engine, uint64_t sourceOffset, bool reverse, std::vector<float>& field)
+    {
+        engine.run(sourceOffset, DeltaStepping::maxCells(), reverse);
+        field.resize(numCells());
+        for (uint64_t offset = 0; offset < field.size(); ++offset)
+        {
+            field[offset] = engine.time(offset);
+        }
+    }
+
+    NavigationPath pathFromOffsets(const std::vector<uint64_t>& offsets)
+    {
+        NavigationPath res;
+        for (auto it = offsets.rbegin(); it != offsets.rend(); ++it)
+        {
+            res.add(cell(*it));
+        }
+        return res;
+    }
+
+    /***
+     * Answers from the route cache when there is one and the route is there, otherwise runs the search.
+     * @param search Callable returning the route offsets
+     */
+    template <typename Search>
+    NavigationPath routeThroughCache(const SpaceCell& fromCell, const SpaceCell& targetCell, Search search)
+    {
+        if (_routeCache == nullptr)
+        {
+            return pathFromOffsets(search());
+        }
+        const uint64_t fromOffset = fromCell.spaceOffset();
+        const uint64_t targetOffset = targetCell.spaceOffset();
+        std::shared_ptr<const CachedRoute> route = _routeCache->find(fromOffset, targetOffset, id(), _version);
+        if (!route)
+        {
+            std::vector<uint64_t> offsets = search();
+            std::vector<float> cellTimes;
+            for (uint64_t offset : offsets)
+            {
+                cellTimes.push_back(_space[offset]);
+            }
+            route = std::make_shared<const CachedRoute>(std::move(offsets), cellTimes);
+            _routeCache->insert(fromOffset, targetOffset, id(), _version, route);
+        }
+        return pathFromOffsets(route->offsets());
+    }
+
+    /***
+     * A* search over flat offsets. With a heuristic that always returns 0 it is plain Dijkstra.
+     * @param heuristic Callable returning a lower bound of the time from an offset to the target
+     * @return The offsets of the route, from fromCell to targetCell
+     */
+    template <typename Heuristic>
+    std::vector<uint64_t> searchRoute(const SpaceCell& fromCell, const SpaceCell& targetCell, Heuristic heuristic,
+                                      RouteStatistics* statistics)
+    {
+        const uint64_t cellCount = numCells();
+        const AdjacentOffsets adjacent = adjacentOffsets();
+        const uint64_t fromOffset = fromCell.spaceOffset();
+        const uint64_t targetOffset = targetCell.spaceOffset();
+        std::vector<float> timeList(cellCount, std::numeric_limits<float>::max());
+        std::vector<uint64_t> previousOffset(cellCount, undefinedOffset());
+        std::vector<bool> visited(cellCount, false);
         std::priority_queue<OffsetAndTime, std::vector<OffsetAndTime>, offsetAndTimeComparator> priorityQueue;
 
-        priorityQueue.push(OffsetAndTime(fromCell.spaceOffset(), 0));
-        timeList[fromCell.spaceOffset()] = 0;
-        bool targetCellReached = false;
-        while (!priorityQueue.empty() && !targetCellReached)
+        priorityQueue.push(OffsetAndTime(fromOffset, heuristic(fromOffset)));
+        timeList[fromOffset] = 0;
+        while (!priorityQueue.empty())
         {
             uint64_t visitedOffset = priorityQueue.top().getOffset();
             priorityQueue.pop();
-            SpaceCell visitedCell = cell(visitedOffset);
-            targetCellReached = visitedCell == targetCell;
-            std::vector<SpaceCell> adjacentList = visitedCell.getAdjacentCells();
-            std::vector<SpaceCell>::const_iterator it;
-            for (it = adjacentList.begin(); it != adjacentList.end(); ++it)
+            if (visited[visitedOffset])
+            {
+                continue;
+            }
+            visited[visitedOffset] = true;
+            if (statistics != nullptr)
+            {
+                statistics->addExpandedCell();
+            }
+            if (visitedOffset == targetOffset)
             {
-                uint64_t vOffset = it->spaceOffset();
-                float newTime = timeList[visitedOffset] + spaceTime(*it);
+                break;
+            }
+            adjacent.forEach(visitedOffset, [&](uint64_t vOffset) {
+                float newTime = timeList[visitedOffset] + _space[vOffset];
                 if (timeList[vOffset] > newTime)
                 {
                     timeList[vOffset] = newTime;
-                    priorityQueue.push(OffsetAndTime(vOffset, newTime));
-                    previousCell[vOffset] = visitedCell;
+                    priorityQueue.push(OffsetAndTime(vOffset, newTime + heuristic(vOffset)));
+                    previousOffset[vOffset] = visitedOffset;
                 }
-            }
+            });
+        }
+        std::vector<uint64_t> path;
+        uint64_t uOffset = targetOffset;
+        while (uOffset != undefinedOffset())
+        {
+            path.push_back(uOffset);
+            uOffset = previousOffset[uOffset];
         }
-        NavigationPath path = NavigationPath();
-        SpaceCell uCell = targetCell;
-        if (previousCell[uCell.spaceOffset()].isDefined() || uCell == targetCell)
+        std::reverse(path.begin(), path.end());
+
+        return path;
+    }
+
+    /***
+     * Time from a cell to every cell in a MovementMode::ForwardOnly map. As moves always increase the offset, a single sweep in offset order
+     * visits every cell after all its predecessors, so no priority queue is needed.
+     */
+    void forwardTimeField(uint64_t fromOffset, std::vector<float>& field)
+    {
+        const uint64_t cellCount = numCells();
+        const std::vector<uint64_t> strides = dimensionStrides();
+        field.assign(cellCount, std::numeric_limits<float>::infinity());
+        field[fromOffset] = 0;
+        for (uint64_t offset = fromOffset + 1; offset < cellCount; ++offset)
         {
-            while (uCell.isDefined())
+            float best = std::numeric_limits<float>::infinity();
+            for (uint64_t i = 0; i < strides.size(); ++i)
             {
-                path.add(uCell);
-                uCell = previousCell[uCell.spaceOffset()];
+                if ((offset / strides[i]) % _layout.dimensionSize(i) > 0)
+                {
+                    best = std::min(best, field[offset - strides[i]]);
+                }
             }
+            field[offset] = best + _space[offset];
         }
+    }
 
-        return path;
+    /***
+     * Time from every cell in a MovementMode::ForwardOnly map to a cell, sweeping in reverse offset order.
+     */
+    void backwardTimeField(uint64_t toOffset, std::vector<float>& field)
+    {
+        const std::vector<uint64_t> strides = dimensionStrides();
+        field.assign(numCells(), std::numeric_limits<float>::infinity());
+        field[toOffset] = 0;
+        for (uint64_t offset = toOffset; offset-- > 0;)
+        {
+            float best = std::numeric_limits<float>::infinity();
+            for (uint64_t i = 0; i < strides.size(); ++i)
+            {
+                if ((offset / strides[i]) % _layout.dimensionSize(i) + 1 < _layout.dimensionSize(i))
+                {
+                    best = std::min(best, field[offset + strides[i]] + _space[offset + strides[i]]);
+                }
+            }
+            field[offset] = best;
+        }
     }
 
-  private:
-    float spaceTime(SpaceCell cell)
+    /***
+     * Time from a cell to every cell, or from every cell to it when reversed, with a sequential Dijkstra search. Used
+     * for the spaces with cycles that are too big for the delta-stepping engine.
+     */
+    void dijkstraTimeField(uint64_t sourceOffset, bool reverse, std::vector<float>& field)
     {
-        return _space[cell.spaceOffset()];
+        const AdjacentOffsets adjacent = adjacentOffsets();
+        std::vector<bool> visited(numCells(), false);
+        std::priority_queue<OffsetAndTime, std::vector<OffsetAndTime>, offsetAndTimeComparator> priorityQueue;
+        field.assign(numCells(), std::numeric_limits<float>::infinity());
+        field[sourceOffset] = 0;
+        priorityQueue.push(OffsetAndTime(sourceOffset, 0));
+        while (!priorityQueue.empty())
+        {
+            uint64_t visitedOffset = priorityQueue.top().getOffset();
+            priorityQueue.pop();
+            if (visited[visitedOffset])
+            {
+                continue;
+            }
+            visited[visitedOffset] = true;
+            adjacent.forEach(visitedOffset, [&](uint64_t vOffset) {
+                // Going back through the route costs the time of the cell left
+                float newTime = field[visitedOffset] + (reverse ? _space[visitedOffset] : _space[vOffset]);
+                if (field[vOffset] > newTime)
+                {
+                    field[vOffset] = newTime;
+                    priorityQueue.push(OffsetAndTime(vOffset, newTime));
+                }
+            });
+        }
     }
 };
 
@@ -0,0 +1,111 @@
+#ifndef HYPERSPACE_NAVIGATOR_WORKER_POOL_HPP
+#define HYPERSPACE_NAVIGATOR_WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hyperspace_navigator {
+
+/***
+ * Fixed set of threads running the same task, each one with its own thread index, until all of them finish.
+ */
+class WorkerPool
+{
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _startCondition;
+    std::condition_variable _doneCondition;
+    std::function<void(unsigned)> _task;
+    uint64_t _generation = 0;
+    uint64_t _pending = 0;
+    bool _stopping = false;
+
+  public:
+    /***
+     * Starts the worker threads. The calling thread is used as one of them.
+     * @param numThreads Total number of threads running each task
+     */
+    explicit WorkerPool(unsigned numThreads)
+        : _threads(), _mutex(), _startCondition(), _doneCondition(), _task()
+    {
+        for (unsigned i = 1; i < numThreads; ++i)
+        {
+            _threads.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _startCondition.notify_all();
+        for (std::thread& thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    /***
+     * Number of threads running each task, including the calling one
+     */
+    unsigned numThreads() const { return static_cast<unsigned>(_threads.size() + 1); }
+
+    /***
+     * Runs task(threadIndex) on every thread and waits for all of them
+     * @param task The task, it must not throw
+     */
+    void run(const std::function<void(unsigned)>& task)
+    {
+        if (_threads.empty())
+        {
+            task(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _task = task;
+            _pending = _threads.size();
+            _generation++;
+        }
+        _startCondition.notify_all();
+        task(0);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _doneCondition.wait(lock, [this]() { return _pending == 0; });
+    }
+
+  private:
+    void work(unsigned threadIndex)
+    {
+        uint64_t generation = 0;
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _startCondition.wait(lock, [this, generation]() { return _stopping || _generation != generation; });
+            if (_stopping)
+            {
+                return;
+            }
+            generation = _generation;
+            lock.unlock();
+            _task(threadIndex);
+            lock.lock();
+            if (--_pending == 0)
+            {
+                _doneCondition.notify_one();
+            }
+        }
+    }
+};
+
+} // namespace hyperspace_navigator
+
+#endif
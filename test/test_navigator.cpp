@@ -1,6 +1,9 @@
 #include <hyperspace_navigator.hpp>
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
+#include <cmath>
+#include <sstream>
+#include <thread>
 
 namespace hyperspace_navigator {
 
@@ -50,6 +53,22 @@ TEST_CASE("test_create_cell_from_2d_space_offset")
     REQUIRE(cell.numDimensions() == 2);
 }
 
+TEST_CASE("test_create_cell_from_3d_space_offset")
+{
+    SpaceMap map = SpaceMap({}, SpaceLayout({2, 3, 2}));
+    SpaceCell cell = map.cell(9);
+    REQUIRE(cell.dimensionIndex(0) == 1);
+    REQUIRE(cell.dimensionIndex(1) == 1);
+    REQUIRE(cell.dimensionIndex(2) == 1);
+    REQUIRE(cell.spaceOffset() == 9);
+
+    cell = map.cell(11);
+    REQUIRE(cell.dimensionIndex(0) == 1);
+    REQUIRE(cell.dimensionIndex(1) == 2);
+    REQUIRE(cell.dimensionIndex(2) == 1);
+    REQUIRE(cell.spaceOffset() == 11);
+}
+
 TEST_CASE("test_3d_space_map_creation")
 {
     float space[2 * 2 * 2] = {0.F, 1.F,
@@ -111,6 +130,519 @@ TEST_CASE("test_fastest_route_using_std_vector")
     REQUIRE(navigationTime == Approx(14.F));
 }
 
+TEST_CASE("test_fastest_route_with_landmarks_in_2d_space")
+{
+    float space[3 * 3] = {
+        0.F, 1.F, 3.F,
+        5.F, 2.F, 8.F,
+        1.F, 5.F, 6.F};
+    SpaceMap map = SpaceMap(space, SpaceLayout({3, 3}));
+    SpaceLandmarks landmarks = map.landmarks(4);
+    REQUIRE(landmarks.numLandmarks() == 4);
+    REQUIRE(landmarks.offset(0) == map.spaceStart().spaceOffset());
+    REQUIRE(landmarks.offset(1) == map.spaceEnd().spaceOffset());
+    REQUIRE(landmarks.forwardTime(0, map.spaceEnd().spaceOffset()) == Approx(14.F));
+    REQUIRE(landmarks.backwardTime(1, map.spaceStart().spaceOffset()) == Approx(14.F));
+
+    NavigationPath navigationPath = map.fastestRoute(map.spaceStart(), map.spaceEnd(), landmarks);
+    REQUIRE(navigationPath.numCells() == 5);
+    REQUIRE(map.time(navigationPath) == Approx(14.F));
+    std::vector<SpaceCell> pathCells = navigationPath.cells();
+    REQUIRE(pathCells[1] == map.cell({1, 0}));
+    REQUIRE(pathCells[2] == map.cell({1, 1}));
+    REQUIRE(pathCells[3] == map.cell({1, 2}));
+}
+
+TEST_CASE("test_fastest_route_with_landmarks_matches_dijkstra")
+{
+    const uint64_t size = 24;
+    std::vector<float> space(size * size * 2);
+    uint32_t seed = 7;
+    for (float& time : space)
+    {
+        seed = seed * 1103515245U + 12345U;
+        // Obstacle heavy field: one cell out of four is very slow to cross
+        time = (seed >> 16U) % 4 == 0 ? 100.F : static_cast<float>((seed >> 20U) % 10);
+    }
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({size, size, 2}));
+    SpaceLandmarks landmarks = map.landmarks(6);
+    SpaceCell fromCell = map.cell({2, 3, 0});
+    SpaceCell targetCell = map.cell({20, 21, 1});
+
+    RouteStatistics dijkstraStatistics;
+    RouteStatistics landmarksStatistics;
+    NavigationPath dijkstraPath = map.fastestRoute(fromCell, targetCell, &dijkstraStatistics);
+    NavigationPath landmarksPath = map.fastestRoute(fromCell, targetCell, landmarks, &landmarksStatistics);
+    REQUIRE(map.time(landmarksPath) == Approx(map.time(dijkstraPath)));
+    REQUIRE(landmarksStatistics.expandedCells() > 0);
+    REQUIRE(landmarksStatistics.expandedCells() < dijkstraStatistics.expandedCells());
+}
+
+TEST_CASE("test_landmarks_save_and_load")
+{
+    float space[3 * 3] = {
+        0.F, 1.F, 3.F,
+        5.F, 2.F, 8.F,
+        1.F, 5.F, 6.F};
+    SpaceMap map = SpaceMap(space, SpaceLayout({3, 3}));
+    SpaceLandmarks landmarks = map.landmarks(20);
+    REQUIRE(landmarks.numLandmarks() == 9);
+
+    std::stringstream stream;
+    landmarks.save(stream);
+    SpaceLandmarks loaded = SpaceLandmarks::load(stream);
+    REQUIRE(loaded.numLandmarks() == landmarks.numLandmarks());
+    REQUIRE(loaded.numCells() == landmarks.numCells());
+    for (uint64_t offset = 0; offset < map.numCells(); ++offset)
+    {
+        REQUIRE(loaded.offset(offset) == landmarks.offset(offset));
+        REQUIRE(loaded.lowerBound(offset, 8) == Approx(landmarks.lowerBound(offset, 8)));
+    }
+    NavigationPath navigationPath = map.fastestRoute(map.spaceStart(), map.spaceEnd(), loaded);
+    REQUIRE(map.time(navigationPath) == Approx(14.F));
+
+    std::stringstream truncated(stream.str().substr(0, 12));
+    REQUIRE_THROWS_AS(SpaceLandmarks::load(truncated), std::runtime_error);
+
+    SpaceMap bidirectionalMap = SpaceMap(space, SpaceLayout({3, 3}), MovementMode::Bidirectional);
+    std::stringstream bidirectionalStream;
+    bidirectionalMap.landmarks(2).save(bidirectionalStream);
+    loaded = SpaceLandmarks::load(bidirectionalStream);
+    REQUIRE(loaded.movementMode() == MovementMode::Bidirectional);
+    REQUIRE(loaded.dimensionSizes() == std::vector<uint64_t>({3, 3}));
+    REQUIRE(loaded.spaceChecksum() == bidirectionalMap.spaceChecksum());
+
+    // Header asking for far more data than the stream has, or for a size that overflows
+    for (uint64_t count : {uint64_t(1) << 40U, std::numeric_limits<uint64_t>::max() / 4})
+    {
+        std::string data = stream.str().substr(0, 8);
+        uint64_t header[6] = {2, 3, 3, 0, map.spaceChecksum(), count};
+        data.append(reinterpret_cast<const char*>(header), sizeof(header));
+        std::stringstream corrupt(data);
+        REQUIRE_THROWS_AS(SpaceLandmarks::load(corrupt), std::runtime_error);
+    }
+    for (uint64_t numDimensions : {uint64_t(1) << 40U, uint64_t(4)})
+    {
+        std::string data = stream.str().substr(0, 8);
+        uint64_t header[5] = {numDimensions, uint64_t(1) << 32U, uint64_t(1) << 32U, 3, 3};
+        data.append(reinterpret_cast<const char*>(header), sizeof(header));
+        std::stringstream corrupt(data);
+        REQUIRE_THROWS_AS(SpaceLandmarks::load(corrupt), std::runtime_error);
+    }
+}
+
+TEST_CASE("test_landmarks_of_another_space")
+{
+    const uint64_t size = 20;
+    std::vector<float> space(size * size);
+    std::vector<float> otherSpace(size * size);
+    for (uint64_t i = 0; i < space.size(); ++i)
+    {
+        space[i] = static_cast<float>(i % 7);
+        otherSpace[i] = static_cast<float>((i * 5) % 11);
+    }
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({size, size}));
+    SpaceMap otherMap = SpaceMap(otherSpace.data(), SpaceLayout({size, size}));
+    std::stringstream stream;
+    map.landmarks(4).save(stream);
+    SpaceLandmarks loaded = SpaceLandmarks::load(stream);
+
+    // Same number of cells and version, but the bounds of other times could overestimate
+    REQUIRE(otherMap.version() == map.version());
+    REQUIRE_THROWS_AS(otherMap.fastestRoute(otherMap.spaceStart(), otherMap.spaceEnd(), loaded), std::invalid_argument);
+    NavigationPath navigationPath = map.fastestRoute(map.spaceStart(), map.spaceEnd(), loaded);
+    REQUIRE(map.time(navigationPath) == Approx(map.time(map.fastestRoute(map.spaceStart(), map.spaceEnd()))));
+
+    // Same times in another layout
+    SpaceMap wideMap = SpaceMap(space.data(), SpaceLayout({4, 2}));
+    SpaceMap tallMap = SpaceMap(space.data(), SpaceLayout({2, 4}));
+    REQUIRE_THROWS_AS(tallMap.fastestRoute(tallMap.spaceStart(), tallMap.spaceEnd(), wideMap.landmarks(2)),
+                      std::invalid_argument);
+}
+
+TEST_CASE("test_fastest_route_with_route_cache")
+{
+    std::vector<float> space = {
+        0.F, 1.F, 3.F,
+        5.F, 2.F, 8.F,
+        1.F, 5.F, 6.F};
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({3, 3}));
+    RouteCache cache(8, 2);
+    map.useRouteCache(&cache);
+
+    NavigationPath navigationPath = map.fastestRoute(map.spaceStart(), map.spaceEnd());
+    REQUIRE(cache.misses() == 1);
+    REQUIRE(cache.size() == 1);
+    RouteStatistics statistics;
+    navigationPath = map.fastestRoute(map.spaceStart(), map.spaceEnd(), &statistics);
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(statistics.expandedCells() == 0);
+    REQUIRE(navigationPath.numCells() == 5);
+    REQUIRE(map.time(navigationPath) == Approx(14.F));
+
+    // {1, 0} -> {1, 2} lies on the cached route
+    navigationPath = map.fastestRoute(map.cell({1, 0}), map.cell({1, 2}));
+    REQUIRE(cache.subRouteHits() == 1);
+    REQUIRE(navigationPath.numCells() == 3);
+    REQUIRE(map.time(navigationPath) == Approx(8.F));
+    REQUIRE(navigationPath.cells()[1] == map.cell({1, 1}));
+
+    std::shared_ptr<const CachedRoute> route =
+        cache.find(map.spaceStart().spaceOffset(), map.spaceEnd().spaceOffset(), map.id(), 0);
+    REQUIRE(route);
+    REQUIRE(route->time() == Approx(14.F));
+    REQUIRE(route->subRoute(map.cell({1, 1}).spaceOffset(), map.cell({1, 0}).spaceOffset()) == nullptr);
+
+    space[4] = 20.F;
+    map.markModified();
+    REQUIRE(map.version() == 1);
+    navigationPath = map.fastestRoute(map.spaceStart(), map.spaceEnd());
+    REQUIRE(cache.misses() == 2);
+    REQUIRE(map.time(navigationPath) == Approx(17.F));
+}
+
+TEST_CASE("test_route_cache_shared_by_maps")
+{
+    std::vector<float> space = {
+        0.F, 1.F, 3.F,
+        5.F, 2.F, 8.F,
+        1.F, 5.F, 6.F};
+    std::vector<float> otherSpace = {
+        0.F, 9.F, 9.F,
+        1.F, 9.F, 9.F,
+        1.F, 1.F, 1.F};
+    RouteCache cache(8, 2);
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({3, 3}));
+    SpaceMap otherMap = SpaceMap(otherSpace.data(), SpaceLayout({3, 3}));
+    map.useRouteCache(&cache);
+    otherMap.useRouteCache(&cache);
+
+    // Same end points and version, but each map gets its own route
+    REQUIRE(map.id() != otherMap.id());
+    REQUIRE(map.time(map.fastestRoute(map.spaceStart(), map.spaceEnd())) == Approx(14.F));
+    REQUIRE(otherMap.time(otherMap.fastestRoute(otherMap.spaceStart(), otherMap.spaceEnd())) == Approx(4.F));
+    REQUIRE(otherMap.time(otherMap.fastestRoute(otherMap.cell({0, 1}), otherMap.spaceEnd())) == Approx(4.F));
+    REQUIRE(cache.hits() + cache.subRouteHits() == 1);
+
+    // A copy can change its movement mode on its own, so it does not share the routes either
+    SpaceMap copy = map;
+    REQUIRE(copy.id() != map.id());
+    copy.setMovementMode(MovementMode::Bidirectional);
+    map.markModified();
+    REQUIRE(copy.version() == map.version());
+    REQUIRE(map.time(map.fastestRoute(map.spaceStart(), map.spaceEnd())) == Approx(14.F));
+    REQUIRE(copy.time(copy.fastestRoute(copy.spaceStart(), copy.spaceEnd())) == Approx(14.F));
+    REQUIRE(cache.misses() == 4);
+}
+
+TEST_CASE("test_route_cache_eviction")
+{
+    RouteCache cache(2, 1);
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        cache.insert(i, i + 1, 0, 0, std::make_shared<const CachedRoute>(std::vector<uint64_t>{i, i + 1},
+                                                                         std::vector<float>{1.F, 2.F}));
+    }
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.evictions() == 2);
+    REQUIRE(cache.find(0, 1, 0, 0) == nullptr);
+    REQUIRE(cache.find(3, 4, 0, 0) != nullptr);
+    REQUIRE(cache.find(3, 4, 0, 1) == nullptr);
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+
+    // Routes scanned for a sub route that is not there keep their place in the eviction order
+    for (uint64_t from : {0, 10})
+    {
+        cache.insert(from, from + 5, 0, 0,
+                     std::make_shared<const CachedRoute>(std::vector<uint64_t>{from, from + 1, from + 5},
+                                                         std::vector<float>{1.F, 1.F, 1.F}));
+    }
+    REQUIRE(cache.find(0, 99, 0, 0) == nullptr);
+    cache.insert(20, 25, 0, 0, std::make_shared<const CachedRoute>(std::vector<uint64_t>{20, 25},
+                                                                   std::vector<float>{1.F, 1.F}));
+    REQUIRE(cache.find(10, 15, 0, 0) != nullptr);
+    REQUIRE(cache.find(0, 5, 0, 0) == nullptr);
+    cache.clear();
+
+    // A route stored twice, as when two threads miss at once, is indexed once
+    RouteCache singleCache(1, 1);
+    singleCache.insert(0, 9, 0, 0, std::make_shared<const CachedRoute>(std::vector<uint64_t>{0, 1, 2, 9},
+                                                                       std::vector<float>{1.F, 1.F, 1.F, 1.F}));
+    singleCache.insert(0, 9, 0, 0, std::make_shared<const CachedRoute>(std::vector<uint64_t>{0, 3, 4, 9},
+                                                                       std::vector<float>{1.F, 1.F, 1.F, 1.F}));
+    REQUIRE(singleCache.indexSize() == 4);
+    REQUIRE(singleCache.find(1, 9, 0, 0) != nullptr);
+    singleCache.insert(20, 25, 0, 0, std::make_shared<const CachedRoute>(std::vector<uint64_t>{20, 25},
+                                                                         std::vector<float>{1.F, 1.F}));
+    REQUIRE(singleCache.indexSize() == 2);
+
+    // Less routes than shards
+    for (uint64_t capacity : {0, 1, 5})
+    {
+        RouteCache smallCache(capacity, 16);
+        for (uint64_t i = 0; i < 100; ++i)
+        {
+            smallCache.insert(i, i + 1, 0, 0, std::make_shared<const CachedRoute>(std::vector<uint64_t>{i, i + 1},
+                                                                                  std::vector<float>{1.F, 2.F}));
+            REQUIRE(smallCache.size() <= capacity);
+        }
+    }
+}
+
+TEST_CASE("test_route_cache_concurrent_readers")
+{
+    const uint64_t size = 16;
+    std::vector<float> space(size * size);
+    for (uint64_t i = 0; i < space.size(); ++i)
+    {
+        space[i] = static_cast<float>(i % 7);
+    }
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({size, size}));
+    float expectedTime = map.time(map.fastestRoute(map.spaceStart(), map.spaceEnd()));
+    RouteCache cache(16);
+    map.useRouteCache(&cache);
+
+    std::vector<std::thread> threads;
+    std::vector<float> times(4);
+    for (uint64_t t = 0; t < times.size(); ++t)
+    {
+        threads.emplace_back([&map, &times, t]() {
+            for (int i = 0; i < 50; ++i)
+            {
+                times[t] = map.time(map.fastestRoute(map.spaceStart(), map.spaceEnd()));
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (float time : times)
+    {
+        REQUIRE(time == Approx(expectedTime));
+    }
+    REQUIRE(cache.hits() + cache.subRouteHits() + cache.misses() == 200);
+    REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE("test_fastest_route_bidirectional")
+{
+    float space[3 * 3] = {
+        0.F, 1.F, 1.F,
+        9.F, 9.F, 1.F,
+        1.F, 1.F, 1.F};
+    SpaceMap map = SpaceMap(space, SpaceLayout({3, 3}));
+    NavigationPath navigationPath = map.fastestRoute(map.spaceStart(), map.cell({0, 2}));
+    REQUIRE(map.time(navigationPath) == Approx(10.F));
+
+    map.setMovementMode(MovementMode::Bidirectional);
+    REQUIRE(map.version() == 1);
+    REQUIRE(map.spaceStart().getAdjacentCells(MovementMode::Bidirectional).size() == 2);
+    REQUIRE(map.cell({1, 1}).getAdjacentCells(MovementMode::Bidirectional).size() == 4);
+    navigationPath = map.fastestRoute(map.spaceStart(), map.cell({0, 2}));
+    REQUIRE(navigationPath.numCells() == 7);
+    REQUIRE(map.time(navigationPath) == Approx(6.F));
+    std::vector<SpaceCell> pathCells = navigationPath.cells();
+    REQUIRE(pathCells[3] == map.cell({2, 1}));
+    REQUIRE(pathCells[5] == map.cell({1, 2}));
+
+    navigationPath = map.fastestRoute(map.spaceEnd(), map.spaceStart(), map.landmarks(3));
+    REQUIRE(map.time(navigationPath) == Approx(4.F));
+}
+
+TEST_CASE("test_landmarks_of_another_map_version")
+{
+    float space[3 * 3] = {
+        0.F, 1.F, 1.F,
+        9.F, 9.F, 1.F,
+        1.F, 1.F, 1.F};
+    SpaceMap map = SpaceMap(space, SpaceLayout({3, 3}));
+    SpaceLandmarks forwardLandmarks = map.landmarks(3);
+    REQUIRE(forwardLandmarks.movementMode() == MovementMode::ForwardOnly);
+
+    // Forward only times overestimate the bounds once moving back is allowed
+    map.setMovementMode(MovementMode::Bidirectional);
+    REQUIRE_THROWS_AS(map.fastestRoute(map.spaceStart(), map.cell({0, 2}), forwardLandmarks), std::invalid_argument);
+    SpaceLandmarks landmarks = map.landmarks(3);
+    NavigationPath navigationPath = map.fastestRoute(map.spaceStart(), map.cell({0, 2}), landmarks);
+    REQUIRE(map.time(navigationPath) == Approx(6.F));
+    navigationPath = map.fastestRoute(map.spaceStart(), map.cell({1, 2}), landmarks);
+    REQUIRE(map.time(navigationPath) == Approx(5.F));
+
+    space[4] = 0.F;
+    map.markModified();
+    REQUIRE_THROWS_AS(map.fastestRoute(map.spaceStart(), map.cell({1, 2}), landmarks), std::invalid_argument);
+    navigationPath = map.fastestRoute(map.spaceStart(), map.cell({1, 2}), map.landmarks(3));
+    REQUIRE(map.time(navigationPath) == Approx(2.F));
+}
+
+TEST_CASE("test_delta_stepping_matches_dijkstra")
+{
+    const uint64_t size = 160;
+    std::vector<float> space(size * size);
+    uint32_t seed = 3;
+    for (float& time : space)
+    {
+        seed = seed * 1103515245U + 12345U;
+        time = (seed >> 16U) % 4 == 0 ? 50.F : static_cast<float>((seed >> 20U) % 10);
+    }
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({size, size}), MovementMode::Bidirectional);
+    SpaceCell fromCell = map.cell({150, 10});
+    SpaceCell targetCell = map.cell({5, 140});
+    // Without landmarks the A* search is plain Dijkstra
+    NavigationPath dijkstraPath = map.fastestRoute(fromCell, targetCell, map.landmarks(0));
+    float dijkstraTime = map.time(dijkstraPath);
+
+    for (float delta : {0.F, 1.F, 20.F, 100.F})
+    {
+        map.setDeltaStepping(4, delta);
+        RouteStatistics statistics;
+        NavigationPath navigationPath = map.fastestRoute(fromCell, targetCell, &statistics);
+        REQUIRE(map.time(navigationPath) == Approx(dijkstraTime));
+        REQUIRE(navigationPath.cells().front() == fromCell);
+        REQUIRE(navigationPath.cells().back() == targetCell);
+        REQUIRE(statistics.expandedCells() > 0);
+    }
+
+    std::vector<uint64_t> dimensionSizes = {size, size};
+    DeltaStepping engine(space.data(), map.numCells(), AdjacentOffsets(dimensionSizes, MovementMode::Bidirectional),
+                         5.F, 4);
+    engine.run(targetCell.spaceOffset(), DeltaStepping::maxCells(), true);
+    // Time to reach the target from fromCell, without crossing fromCell itself
+    REQUIRE(engine.time(fromCell.spaceOffset()) == Approx(dijkstraTime - space[fromCell.spaceOffset()]));
+    REQUIRE(engine.previousOffset(targetCell.spaceOffset()) == DeltaStepping::maxCells());
+}
+
+TEST_CASE("test_delta_stepping_concurrent_routes")
+{
+    const uint64_t size = 192;
+    std::vector<float> space(size * size);
+    for (uint64_t i = 0; i < space.size(); ++i)
+    {
+        space[i] = static_cast<float>((i * 7) % 11);
+    }
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({size, size}), MovementMode::Bidirectional);
+    // Big buckets, so the engine threads share the relaxations
+    map.setDeltaStepping(4, 60.F);
+    REQUIRE(map.deltaSteppingThreads() == 3);
+    std::vector<SpaceCell> targets = {map.spaceEnd(), map.cell({0, 191}), map.cell({191, 0}), map.cell({90, 120})};
+    std::vector<float> expectedTimes;
+    for (const SpaceCell& target : targets)
+    {
+        expectedTimes.push_back(map.time(map.fastestRoute(map.spaceStart(), target)));
+    }
+
+    // Every thread shares the engine of the map
+    std::vector<std::thread> threads;
+    std::vector<std::vector<float>> times(4, std::vector<float>(targets.size()));
+    for (uint64_t t = 0; t < times.size(); ++t)
+    {
+        threads.emplace_back([&map, &targets, &times, t]() {
+            for (int i = 0; i < 3; ++i)
+            {
+                for (uint64_t target = 0; target < targets.size(); ++target)
+                {
+                    times[t][target] = map.time(map.fastestRoute(map.spaceStart(), targets[target]));
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (const std::vector<float>& threadTimes : times)
+    {
+        for (uint64_t target = 0; target < targets.size(); ++target)
+        {
+            REQUIRE(threadTimes[target] == Approx(expectedTimes[target]));
+        }
+    }
+}
+
+TEST_CASE("test_evaluate_path_batch")
+{
+    float space[3 * 3] = {
+        0.F, 1.F, 3.F,
+        5.F, 2.F, 8.F,
+        1.F, 5.F, 6.F};
+    SpaceMap map = SpaceMap(space, SpaceLayout({3, 3}));
+    PathBatch paths;
+    std::vector<uint64_t> fastest = {0, 1, 4, 7, 8};
+    std::vector<uint64_t> wrapping = {2, 3};
+    std::vector<uint64_t> backward = {4, 1};
+    std::vector<uint64_t> outside = {8, 9};
+    paths.add(fastest.data(), fastest.size());
+    paths.add(wrapping.data(), wrapping.size());
+    paths.add(backward.data(), backward.size());
+    paths.add(outside.data(), outside.size());
+    paths.add(nullptr, 0);
+    REQUIRE(paths.numPaths() == 5);
+
+    PathBatchResult result = map.evaluate(paths);
+    REQUIRE(result.numPaths() == 5);
+    REQUIRE(result.isValid(0));
+    REQUIRE(result.time(0) == Approx(map.time(map.fastestRoute(map.spaceStart(), map.spaceEnd()))));
+    REQUIRE_FALSE(result.isValid(1));
+    REQUIRE(std::isnan(result.time(1)));
+    REQUIRE_FALSE(result.isValid(2));
+    REQUIRE_FALSE(result.isValid(3));
+    REQUIRE_FALSE(result.isValid(4));
+
+    map.setMovementMode(MovementMode::Bidirectional);
+    result = map.evaluate(paths);
+    REQUIRE_FALSE(result.isValid(1));
+    REQUIRE(result.isValid(2));
+    REQUIRE(result.time(2) == Approx(3.F));
+
+    PathBatch indexPaths = map.pathBatch({0, 0, 1, 0, 1, 1, 1, 2, 2, 2, 0, 0, 3, 0}, {0, 5, 7});
+    REQUIRE(indexPaths.numPaths() == 2);
+    REQUIRE(indexPaths.pathOffsets(0)[3] == 7);
+    result = map.evaluate(indexPaths);
+    REQUIRE(result.time(0) == Approx(14.F));
+    REQUIRE_FALSE(result.isValid(1));
+
+    REQUIRE_THROWS_AS(PathBatch({0, 1}, {0, 3}), std::invalid_argument);
+}
+
+TEST_CASE("test_evaluate_path_batch_matches_navigation_path_time")
+{
+    const uint64_t size = 64;
+    std::vector<float> space(size * size * 4);
+    for (uint64_t i = 0; i < space.size(); ++i)
+    {
+        space[i] = static_cast<float>(i % 13) * 0.5F;
+    }
+    SpaceMap map = SpaceMap(space.data(), SpaceLayout({size, size, 4}));
+    PathBatch paths;
+    std::vector<NavigationPath> navigationPaths;
+    for (uint64_t i = 0; i < 3000; ++i)
+    {
+        // Staircase from a different starting cell each time, with a different length
+        std::vector<uint64_t> offsets;
+        SpaceIndex index = {i % 7, i % 11, i % 4};
+        for (uint64_t step = 0; step < 2 + i % 60; ++step)
+        {
+            offsets.push_back(map.cell(index).spaceOffset());
+            index[step % 2]++;
+        }
+        paths.add(offsets.data(), offsets.size());
+        NavigationPath navigationPath;
+        for (auto it = offsets.rbegin(); it != offsets.rend(); ++it)
+        {
+            navigationPath.add(map.cell(*it));
+        }
+        navigationPaths.push_back(navigationPath);
+    }
+    PathBatchResult result = map.evaluate(paths, 4);
+    for (uint64_t i = 0; i < paths.numPaths(); ++i)
+    {
+        REQUIRE(result.isValid(i));
+        REQUIRE(result.time(i) == Approx(map.time(navigationPaths[i])));
+    }
+}
+
 TEST_CASE("test version")
 {
     REQUIRE(HYPERSPACE_NAVIGATOR_VERSION_STRING == std::string("1.0.0"));